@@ -7,6 +7,8 @@
 #include "eva/ckks/ckks_config.h"
 #include "eva/ckks/ckks_parameters.h"
 #include "eva/ckks/ckks_signature.h"
+#include "eva/ckks/compilation_cache.h"
+#include "eva/ckks/cost_estimator.h"
 #include "eva/ckks/eager_relinearizer.h"
 #include "eva/ckks/eager_waterline_rescaler.h"
 #include "eva/ckks/encode_inserter.h"
@@ -16,22 +18,117 @@
 #include "eva/ckks/levels_checker.h"
 #include "eva/ckks/minimum_rescaler.h"
 #include "eva/ckks/mod_switcher.h"
+#include "eva/ckks/optimal_relinearizer.h"
 #include "eva/ckks/parameter_checker.h"
+#include "eva/ckks/rotation_decomposer.h"
+#include "eva/ckks/scale_level_cache.h"
 #include "eva/ckks/scales_checker.h"
 #include "eva/ckks/seal_lowering.h"
+#include "eva/common/algebraic_simplifier.h"
+#include "eva/common/common_subexpression_eliminator.h"
 #include "eva/common/constant_folder.h"
+#include "eva/common/instance_packer.h"
+#include "eva/common/linearity_checker.h"
+#include "eva/common/matvec_lowering.h"
+#include "eva/common/polynomial_lowering.h"
+#include "eva/common/program_hasher.h"
+#include "eva/common/power_expander.h"
 #include "eva/common/program_traversal.h"
+#include "eva/common/reduce_lowering.h"
 #include "eva/common/reduction_balancer.h"
+#include "eva/common/rotation_canonicalizer.h"
+#include "eva/common/rotation_factorizer.h"
+#include "eva/common/rotation_folder.h"
 #include "eva/common/rotation_keys_selector.h"
 #include "eva/common/type_deducer.h"
+#include "eva/common/vector_tiler.h"
+#include "eva/util/hash.h"
 #include "eva/util/logging.h"
+#include "eva/util/thread_pool.h"
+#include "eva/version.h"
+#include <algorithm>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <seal/modulus.h>
 #include <seal/util/hestdparms.h>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace eva {
 
+// One of the configurations tried by CKKSCompiler::autotune
+struct CKKSAutotuneResult {
+  // The options that were varied, in the form accepted by CKKSConfig
+  std::unordered_map<std::string, std::string> options;
+  // Estimated by CostEstimator, or seconds of execution if measured
+  double cost = 0;
+  bool measured = false;
+  std::uint32_t polyModulusDegree = 0;
+  std::size_t primeCount = 0;
+  // Why the compilation failed, or empty if it succeeded
+  std::string error;
+};
+
 class CKKSCompiler {
   CKKSConfig config;
+  // Set for the compilers run by autotune, which already uses all hardware
+  // threads, to search rescale divisors without starting more threads
+  bool searchSerially = false;
+
+  // Lowers the ops that are not supported by the other passes
+  void lower(Program &program) {
+    auto programRewrite = ProgramTraversal(program);
+
+    log(Verbosity::Debug, "Running PolynomialLowering pass");
+    PolynomialLowering polynomialLowering(program);
+    programRewrite.forwardPass(polynomialLowering);
+    polynomialLowering.lower();
+    log(Verbosity::Debug, "Running MatVecLowering pass");
+    MatVecLowering matVecLowering(program);
+    programRewrite.forwardPass(matVecLowering);
+    matVecLowering.lower();
+  }
+
+  // Splits the vectors of program into tiles of config.tileSize elements.
+  // Returns the tiled program and the number of tiles.
+  std::pair<std::unique_ptr<Program>, std::uint32_t> tile(Program &program) {
+    log(Verbosity::Debug, "Running VectorTiler pass");
+    VectorTiler tiler(program, config.tileSize);
+    ProgramTraversal(program).forwardPass(tiler);
+    log(Verbosity::Info, "Split vectors of size %u into %u tiles of size %u",
+        program.getVecSize(), tiler.getTileCount(), config.tileSize);
+    return {tiler.getProgram(), tiler.getTileCount()};
+  }
+
+  // Checks that the imaginary parts of the slots can hold another instance
+  bool isComplexPackable(Program &program, std::uint32_t tileCount) {
+    if (tileCount > 1) {
+      warn("Complex packing is not supported for tiled programs. Compiling "
+           "%s without it.",
+           program.getName().c_str());
+      return false;
+    }
+    log(Verbosity::Debug, "Running LinearityChecker pass");
+    LinearityChecker checker(program);
+    ProgramTraversal(program).forwardPass(checker);
+    if (!checker.isLinear()) {
+      warn("Complex packing requires a program that is linear in its inputs. "
+           "Compiling %s without it.",
+           program.getName().c_str());
+      return false;
+    }
+    log(Verbosity::Info, "Packing two instances of %s per slot",
+        program.getName().c_str());
+    return true;
+  }
 
   void transform(Program &program, TermMap<Type> &types,
                  TermMapOptional<std::uint32_t> &scales) {
@@ -39,20 +136,52 @@ class CKKSCompiler {
 
     log(Verbosity::Debug, "Running TypeDeducer pass");
     programRewrite.forwardPass(TypeDeducer(program, types));
+    // Types are kept up to date from here on as the passes below rewrite terms
+    IncrementalTypeDeducer typeDeducer(program, types);
+    // Reductions are lowered after tiling, which handles them specially
+    log(Verbosity::Debug, "Running ReduceLowering pass");
+    ReduceLowering reduceLowering(program, types, config.packInstances,
+                                  config.maxRotationKeys);
+    programRewrite.forwardPass(reduceLowering);
+    reduceLowering.lower();
     log(Verbosity::Debug, "Running ConstantFolder pass");
     programRewrite.forwardPass(ConstantFolder(
         program, scales)); // currently required because executor/runtime
                            // does not handle this
+    log(Verbosity::Debug, "Running AlgebraicSimplifier pass");
+    programRewrite.forwardPass(AlgebraicSimplifier(program, scales));
+    log(Verbosity::Debug, "Running RotationFolder pass");
+    programRewrite.forwardPass(RotationFolder(program));
+    log(Verbosity::Debug, "Running RotationFactorizer pass");
+    programRewrite.forwardPass(RotationFactorizer(program, scales));
+    log(Verbosity::Debug, "Running RotationCanonicalizer pass");
+    programRewrite.forwardPass(RotationCanonicalizer(program));
+    log(Verbosity::Debug, "Running CommonSubexpressionEliminator pass");
+    programRewrite.forwardPass(CommonSubexpressionEliminator(program));
     if (config.balanceReductions) {
       log(Verbosity::Debug, "Running ReductionCombiner pass");
       programRewrite.forwardPass(ReductionCombiner(program));
+      log(Verbosity::Debug, "Running PowerExpander pass");
+      programRewrite.forwardPass(PowerExpander(program, types));
       log(Verbosity::Debug, "Running ReductionLogExpander pass");
       programRewrite.forwardPass(ReductionLogExpander(program, types));
+      // Balancing may produce identical subtrees, e.g., for powers
+      log(Verbosity::Debug, "Running CommonSubexpressionEliminator pass");
+      programRewrite.forwardPass(CommonSubexpressionEliminator(program));
+    }
+    // Must run after the passes above, which treat rotations as cyclic in the
+    // vector size
+    if (config.packInstances) {
+      log(Verbosity::Debug, "Running InstancePacker pass");
+      InstancePacker packer(program, scales);
+      programRewrite.forwardPass(packer);
+      packer.pack();
     }
     switch (config.rescaler) {
     case CKKSRescaler::Minimum:
       log(Verbosity::Debug, "Running MinimumRescaler pass");
-      programRewrite.forwardPass(MinimumRescaler(program, types, scales));
+      programRewrite.forwardPass(
+          MinimumRescaler(program, types, scales, config.rescaleDivisor));
       break;
     case CKKSRescaler::Always:
       log(Verbosity::Debug, "Running AlwaysRescaler pass");
@@ -60,49 +189,58 @@ class CKKSCompiler {
       break;
     case CKKSRescaler::EagerWaterline:
       log(Verbosity::Debug, "Running EagerWaterlineRescaler pass");
-      programRewrite.forwardPass(
-          EagerWaterlineRescaler(program, types, scales));
+      programRewrite.forwardPass(EagerWaterlineRescaler(
+          program, types, scales, config.rescaleDivisor));
       break;
     case CKKSRescaler::LazyWaterline:
       log(Verbosity::Debug, "Running LazyWaterlineRescaler pass");
-      programRewrite.forwardPass(LazyWaterlineRescaler(program, types, scales));
+      programRewrite.forwardPass(LazyWaterlineRescaler(
+          program, types, scales, config.rescaleDivisor));
       break;
     default:
       throw std::logic_error("Unhandled rescaler in CKKSCompiler.");
     }
-    log(Verbosity::Debug, "Running TypeDeducer pass");
-    programRewrite.forwardPass(TypeDeducer(program, types));
 
     log(Verbosity::Debug, "Running EncodeInserter pass");
     programRewrite.forwardPass(EncodeInserter(program, types, scales));
-    log(Verbosity::Debug, "Running TypeDeducer pass");
-    programRewrite.forwardPass(TypeDeducer(program, types));
-    // TODO: rerunning the type deducer at every step is wasteful, but also
-    // forcing other passes to always keep type information up to date isn't
-    // something they should need to do. Type deduction should be changed
-    // into a thing that is done as needed locally.
-    if (config.lazyRelinearize) {
+    if (config.optimalRelinearize) {
+      log(Verbosity::Debug, "Running OptimalRelinearizer pass");
+      OptimalRelinearizer relinearizer(program, types, scales);
+      programRewrite.forwardPass(relinearizer);
+      relinearizer.relinearize();
+    } else if (config.lazyRelinearize) {
       log(Verbosity::Debug, "Running LazyRelinearizer pass");
       programRewrite.forwardPass(LazyRelinearizer(program, types, scales));
     } else {
       log(Verbosity::Debug, "Running EagerRelinearizer pass");
       programRewrite.forwardPass(EagerRelinearizer(program, types, scales));
     }
-    log(Verbosity::Debug, "Running TypeDeducer pass");
-    programRewrite.forwardPass(TypeDeducer(program, types));
     log(Verbosity::Debug, "Running ModSwitcher pass");
     programRewrite.backwardPass(ModSwitcher(program, types, scales));
-    log(Verbosity::Debug, "Running TypeDeducer pass");
-    programRewrite.forwardPass(TypeDeducer(program, types));
+    if (config.maxRotationKeys > 0) {
+      log(Verbosity::Debug, "Running RotationDecomposer pass");
+      RotationDecomposer decomposer(program, types, scales,
+                                    config.maxRotationKeys);
+      programRewrite.forwardPass(
+          [&](Term::Ptr &term) { decomposer.count(term); });
+      if (decomposer.selectKeys()) {
+        log(Verbosity::Info,
+            "Decomposing rotations into %zu rotation keys for "
+            "max_rotation_keys=%u",
+            decomposer.getKeys().size(), config.maxRotationKeys);
+        programRewrite.forwardPass(decomposer);
+        decomposer.decompose();
+      }
+    }
     log(Verbosity::Debug, "Running SEALLowering pass");
     programRewrite.forwardPass(SEALLowering(program, types));
   }
 
   void validate(Program &program, TermMap<Type> &types,
-                TermMapOptional<std::uint32_t> &scales) {
+                ScaleLevelCache &scalesAndLevels) {
     auto programTraverse = ProgramTraversal(program);
     log(Verbosity::Debug, "Running LevelsChecker pass");
-    LevelsChecker lc(program, types);
+    LevelsChecker lc(program, types, scalesAndLevels);
     programTraverse.forwardPass(lc);
     try {
       log(Verbosity::Debug, "Running ParameterChecker pass");
@@ -129,7 +267,7 @@ class CKKSCompiler {
       }
     }
     log(Verbosity::Debug, "Running ScalesChecker pass");
-    ScalesChecker sc(program, scales, types);
+    ScalesChecker sc(program, scalesAndLevels, types);
     programTraverse.forwardPass(sc);
   }
 
@@ -153,53 +291,48 @@ class CKKSCompiler {
     }
   }
 
+  // Returns the maximum bit counts for each degree at the security level
+  int (*getMaxBitsFunction())(std::size_t) {
+    if (config.securityLevel <= 128) {
+      return config.quantumSafe ? &seal::util::seal_he_std_parms_128_tq
+                                : &seal::util::seal_he_std_parms_128_tc;
+    } else if (config.securityLevel <= 192) {
+      return config.quantumSafe ? &seal::util::seal_he_std_parms_192_tq
+                                : &seal::util::seal_he_std_parms_192_tc;
+    } else if (config.securityLevel <= 256) {
+      return config.quantumSafe ? &seal::util::seal_he_std_parms_256_tq
+                                : &seal::util::seal_he_std_parms_256_tc;
+    } else {
+      throw std::runtime_error(
+          "EVA has support for up to 256 bit security, but " +
+          std::to_string(config.securityLevel) +
+          " bit security was requested.");
+    }
+  }
+
   void determineEncryptionParameters(Program &program,
                                      CKKSParameters &encParams,
-                                     TermMapOptional<std::uint32_t> &scales,
+                                     ScaleLevelCache &scalesAndLevels,
                                      TermMap<Type> types) {
     auto programTraverse = ProgramTraversal(program);
     log(Verbosity::Debug, "Running EncryptionParametersSelector pass");
-    EncryptionParametersSelector eps(program, scales, types);
+    EncryptionParametersSelector eps(program, scalesAndLevels, types);
     programTraverse.forwardPass(eps);
     log(Verbosity::Debug, "Running RotationKeysSelector pass");
     RotationKeysSelector rks(program, types);
     programTraverse.forwardPass(rks);
-    encParams.primeBits = eps.getEncryptionParameters();
+    auto maxBitsFun = getMaxBitsFunction();
+    encParams.primeBits = eps.selectEncryptionParameters(maxBitsFun);
     encParams.rotations = rks.getRotationKeys();
 
     int bitCount = 0;
     for (auto &logQ : encParams.primeBits)
       bitCount += logQ;
-    if (config.securityLevel <= 128) {
-      if (config.quantumSafe)
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_128_tq, bitCount);
-      else
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_128_tc, bitCount);
-    } else if (config.securityLevel <= 192) {
-      if (config.quantumSafe)
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_192_tq, bitCount);
-      else
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_192_tc, bitCount);
-    } else if (config.securityLevel <= 256) {
-      if (config.quantumSafe)
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_256_tq, bitCount);
-      else
-        encParams.polyModulusDegree = getMinDegreeForBitCount(
-            &seal::util::seal_he_std_parms_256_tc, bitCount);
-    } else {
-      throw std::runtime_error(
-          "EVA has support for up to 256 bit security, but " +
-          std::to_string(config.securityLevel) +
-          " bit security was requested.");
-    }
+    encParams.polyModulusDegree = getMinDegreeForBitCount(maxBitsFun, bitCount);
 
     auto slots = encParams.polyModulusDegree / 2;
-    if (config.warnVecSize && slots > program.getVecSize()) {
+    if (config.warnVecSize && !config.packInstances &&
+        slots > program.getVecSize()) {
       warn("Program specifies vector size %i while at least %i slots are "
            "required for security. "
            "This does not affect correctness, as the smaller vector size will "
@@ -252,9 +385,20 @@ class CKKSCompiler {
     }
   }
 
-  CKKSSignature extractSignature(const Program &program) {
+  CKKSSignature extractSignature(const Program &program,
+                                 std::uint32_t tileCount,
+                                 std::uint32_t instanceCount,
+                                 bool complexPacked) {
     std::unordered_map<std::string, CKKSEncodingInfo> inputs;
+    std::set<std::string> unusedInputs;
     for (auto &input : program.getInputs()) {
+      // Terms are owned by their uses, so any term no output depends on has
+      // already been released and only the inputs themselves remain
+      if (input.second->numUses() == 0) {
+        log(Verbosity::Info, "Input %s is not used by any output",
+            input.first.c_str());
+        unusedInputs.insert(input.first);
+      }
       Type type = input.second->get<TypeAttribute>();
       assert(type != Type::Undef);
 
@@ -263,20 +407,55 @@ class CKKSCompiler {
           CKKSEncodingInfo(type, input.second->get<EncodeAtScaleAttribute>(),
                            input.second->get<EncodeAtLevelAttribute>()));
     }
-    return CKKSSignature(program.getVecSize(), std::move(inputs));
+    return CKKSSignature(program.getVecSize(), std::move(inputs),
+                         std::move(unusedInputs), tileCount, instanceCount,
+                         complexPacked);
   }
 
-public:
-  CKKSCompiler() {}
-  CKKSCompiler(CKKSConfig config) : config(config) {}
+  // Computes the key for the compilation cache. Options that do not affect
+  // the compilation result are excluded.
+  std::uint64_t getCacheKey(Program &program) {
+    auto programTraverse = ProgramTraversal(program);
+    ProgramHasher ph(program);
+    programTraverse.forwardPass(ph);
+
+    auto keyConfig = config;
+    keyConfig.warnVecSize = CKKSConfig().warnVecSize;
+    keyConfig.cacheDir.clear();
+
+    Hasher hasher;
+    hasher.update(version());
+    hasher.update(keyConfig.toString());
+    hasher.update(ph.getHash());
+    return hasher.digest();
+  }
 
   std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>
-  compile(Program &inputProgram) {
+  compileUncached(Program &inputProgram) {
     auto program = inputProgram.deepCopy();
 
     log(Verbosity::Info, "Compiling %s for CKKS with:\n%s",
         program->getName().c_str(), config.toString(2).c_str());
 
+    lower(*program);
+    std::uint32_t tileCount = 1;
+    if (config.tileSize != 0 && program->getVecSize() > config.tileSize) {
+      std::tie(program, tileCount) = tile(*program);
+    }
+    if (config.packInstances && tileCount > 1) {
+      throw std::runtime_error(
+          "pack_instances cannot be used for programs that are tiled");
+    }
+    // Decomposed rotations are only equivalent modulo the vector size
+    if (config.packInstances && config.maxRotationKeys > 0) {
+      throw std::runtime_error(
+          "pack_instances cannot be combined with max_rotation_keys");
+    }
+    bool complexPacked = false;
+    if (config.complexPacking) {
+      complexPacked = isComplexPackable(*program, tileCount);
+    }
+
     TermMap<Type> types(*program);
     TermMapOptional<std::uint32_t> scales(*program);
     for (auto &source : program->getSources()) {
@@ -294,16 +473,287 @@ public:
       scales[source] = source->get<EncodeAtScaleAttribute>();
     }
 
+    // Kept valid as transform rewrites the program, and computed once for the
+    // checkers and the parameter selection that follow it
+    ScaleLevelCache scalesAndLevels(*program);
     CKKSParameters encParams;
     transform(*program, types, scales);
-    validate(*program, types, scales);
-    determineEncryptionParameters(*program, encParams, scales, types);
+    validate(*program, types, scalesAndLevels);
+    determineEncryptionParameters(*program, encParams, scalesAndLevels, types);
+
+    // Fill the slots that would hold replicas with independent instances
+    std::uint32_t instanceCount = 1;
+    if (config.packInstances) {
+      instanceCount = std::max<std::uint32_t>(
+          1, encParams.polyModulusDegree / 2 / program->getVecSize());
+      log(Verbosity::Info, "Packing %u instances of vector size %u",
+          instanceCount, program->getVecSize());
+    }
 
-    auto signature = extractSignature(*program);
+    auto signature = extractSignature(*program, tileCount, instanceCount,
+                                      complexPacked);
 
     return std::make_tuple(std::move(program), std::move(encParams),
                            std::move(signature));
   }
+
+  // Compiles the program with rescale divisors from 20 to 60 bits in steps of
+  // five and at the scales of the inputs, and returns the compilation with the
+  // lowest cost estimated by CostEstimator on its prime chain. Ties go to the
+  // smaller coefficient modulus.
+  std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>
+  compileWithCheapestRescaleDivisor(Program &inputProgram) {
+    using Compilation =
+        std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>;
+    std::set<std::uint32_t> divisors;
+    if (config.rescaler == CKKSRescaler::Always) {
+      // Always rescales back to the input scale, regardless of the divisor
+      divisors.insert(60);
+    } else {
+      for (std::uint32_t divisor = 20; divisor <= 60; divisor += 5) {
+        divisors.insert(divisor);
+      }
+      for (auto &source : inputProgram.getSources()) {
+        if (!source->has<EncodeAtScaleAttribute>()) continue;
+        std::uint32_t inputScale = source->get<EncodeAtScaleAttribute>();
+        if (inputScale >= 20 && inputScale <= 60) divisors.insert(inputScale);
+      }
+    }
+
+    std::vector<std::uint32_t> candidates(divisors.begin(), divisors.end());
+    std::vector<std::unique_ptr<Program>> copies;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      copies.push_back(inputProgram.deepCopy());
+    }
+    // Without a pool, each divisor is tried on this thread when its result is
+    // requested
+    std::optional<ThreadPool> pool;
+    if (!searchSerially) pool.emplace();
+    std::vector<std::future<Compilation>> futures;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      auto candidate = config;
+      candidate.rescaleDivisor = candidates[i];
+      auto task = [candidate, &copy = *copies[i]]() {
+        auto compilation = CKKSCompiler(candidate).compile(copy);
+        // SEAL may not have enough primes of the small sizes that small
+        // divisors ask for, in which case this throws and fails the candidate
+        auto &params = std::get<1>(compilation);
+        seal::CoeffModulus::Create(
+            params.polyModulusDegree,
+            std::vector<int>(params.primeBits.begin(), params.primeBits.end()));
+        return compilation;
+      };
+      futures.push_back(pool ? pool->submit(task)
+                             : std::async(std::launch::deferred, task));
+    }
+
+    std::optional<Compilation> best;
+    std::pair<double, std::uint32_t> bestCost;
+    std::uint32_t bestDivisor = 0;
+    std::string error;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+      std::optional<Compilation> compilation;
+      try {
+        compilation.emplace(futures[i].get());
+      } catch (const std::exception &e) {
+        log(Verbosity::Debug, "Rescale divisor %u failed with %s",
+            candidates[i], e.what());
+        if (error.empty()) error = e.what();
+        continue;
+      }
+      auto &[program, params, signature] = *compilation;
+      CostEstimator estimator(*program, params);
+      ProgramTraversal(*program).forwardPass(estimator);
+      std::uint32_t modulusBits = 0;
+      for (auto bits : params.primeBits) {
+        modulusBits += bits;
+      }
+      std::pair<double, std::uint32_t> cost(estimator.getCost(), modulusBits);
+      log(Verbosity::Debug,
+          "Rescale divisor %u: cost %g, N = %u, %u bit modulus",
+          candidates[i], cost.first, params.polyModulusDegree, cost.second);
+      if (!best || cost < bestCost) {
+        best.emplace(std::move(*compilation));
+        bestCost = cost;
+        bestDivisor = candidates[i];
+      }
+    }
+    if (!best) {
+      throw std::runtime_error("No rescale divisor could compile " +
+                               inputProgram.getName() + ": " + error);
+    }
+    log(Verbosity::Info, "Selected rescale divisor %u for %s", bestDivisor,
+        inputProgram.getName().c_str());
+    return std::move(*best);
+  }
+
+public:
+  CKKSCompiler() {}
+  CKKSCompiler(CKKSConfig config) : config(config) {}
+
+  std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>
+  compile(Program &inputProgram) {
+    if (config.rescaleDivisor == 0) {
+      return compileWithCheapestRescaleDivisor(inputProgram);
+    }
+    if (!config.cacheDir.empty()) {
+      CompilationCache cache(config.cacheDir);
+      // The copy leaves out terms that no output depends on, which are not
+      // compiled and so must not affect the cache either
+      auto input = inputProgram.deepCopy();
+      auto key = getCacheKey(*input);
+      auto cached = cache.load(key, *input);
+      if (cached) {
+        log(Verbosity::Info, "Loaded %s from compilation cache in %s",
+            inputProgram.getName().c_str(), config.cacheDir.c_str());
+        return std::move(*cached);
+      }
+      auto result = compileUncached(*input);
+      cache.store(key, *input, *std::get<0>(result), std::get<1>(result),
+                  std::get<2>(result));
+      return result;
+    }
+    return compileUncached(inputProgram);
+  }
+
+  using MeasureFunction = std::function<double(
+      Program &, const CKKSParameters &, const CKKSSignature &)>;
+
+  // Compiles the program with every combination of the rescaler, relinearizer
+  // (lazy_relinearize or optimal_relinearize) and balance_reductions options,
+  // with the other options taken from this compiler's config, and returns the
+  // compilation with the lowest cost along with the results for all the
+  // combinations, cheapest first. The cost is estimated with CostEstimator, or
+  // if measure is given, it is the time measure returns for executing the
+  // compiled program.
+  std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature,
+             std::vector<CKKSAutotuneResult>>
+  autotune(Program &inputProgram, const MeasureFunction &measure = nullptr) {
+    using Compilation =
+        std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>;
+    const std::pair<CKKSRescaler, const char *> rescalers[] = {
+        {CKKSRescaler::LazyWaterline, "lazy_waterline"},
+        {CKKSRescaler::EagerWaterline, "eager_waterline"},
+        {CKKSRescaler::Always, "always"},
+        {CKKSRescaler::Minimum, "minimum"}};
+
+    std::vector<CKKSAutotuneResult> results;
+    std::vector<CKKSConfig> configs;
+    for (auto &rescaler : rescalers) {
+      for (auto [lazyRelinearize, optimalRelinearize] :
+           {std::pair(true, false), std::pair(false, false),
+            std::pair(false, true)}) {
+        for (bool balanceReductions : {true, false}) {
+          auto candidate = config;
+          candidate.rescaler = rescaler.first;
+          candidate.lazyRelinearize = lazyRelinearize;
+          candidate.optimalRelinearize = optimalRelinearize;
+          candidate.balanceReductions = balanceReductions;
+          configs.push_back(candidate);
+          CKKSAutotuneResult result;
+          result.options["rescaler"] = rescaler.second;
+          result.options["lazy_relinearize"] =
+              lazyRelinearize ? "true" : "false";
+          result.options["optimal_relinearize"] =
+              optimalRelinearize ? "true" : "false";
+          result.options["balance_reductions"] =
+              balanceReductions ? "true" : "false";
+          results.push_back(result);
+        }
+      }
+    }
+
+    // Copying registers term maps in the copied program, so each compilation
+    // gets its own copy before they run concurrently
+    std::vector<std::unique_ptr<Program>> copies;
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+      copies.push_back(inputProgram.deepCopy());
+    }
+    // Run as many compilations at once as there are hardware threads. The
+    // pool is destroyed first, so the compilations are done before the copies
+    // they use are.
+    ThreadPool pool;
+    std::vector<std::future<Compilation>> futures;
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+      futures.push_back(
+          pool.submit([&candidate = configs[i], &copy = *copies[i]]() {
+            CKKSCompiler compiler(candidate);
+            compiler.searchSerially = true;
+            return compiler.compile(copy);
+          }));
+    }
+
+    std::vector<std::optional<Compilation>> compilations(configs.size());
+    for (std::size_t i = 0; i < configs.size(); ++i) {
+      auto &result = results[i];
+      try {
+        compilations[i].emplace(futures[i].get());
+      } catch (const std::exception &e) {
+        result.error = e.what();
+        continue;
+      }
+      auto &[program, params, signature] = *compilations[i];
+      result.polyModulusDegree = params.polyModulusDegree;
+      result.primeCount = params.primeBits.size();
+      // Measurements run one at a time so that they do not disturb each other
+      if (measure) {
+        result.cost = measure(*program, params, signature);
+        result.measured = true;
+      } else {
+        CostEstimator estimator(*program, params);
+        ProgramTraversal(*program).forwardPass(estimator);
+        result.cost = estimator.getCost();
+      }
+    }
+
+    std::vector<std::size_t> order(configs.size());
+    for (std::size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       bool aFailed = !results[a].error.empty();
+                       bool bFailed = !results[b].error.empty();
+                       if (aFailed != bFailed) return bFailed;
+                       return results[a].cost < results[b].cost;
+                     });
+    auto best = order.front();
+    if (!results[best].error.empty()) {
+      throw std::runtime_error("No configuration could compile " +
+                               inputProgram.getName() + ": " +
+                               results[best].error);
+    }
+
+    std::vector<CKKSAutotuneResult> report;
+    for (auto i : order) {
+      auto &result = results[i];
+      if (result.error.empty()) {
+        log(Verbosity::Info,
+            "Autotuned rescaler=%s lazy_relinearize=%s "
+            "optimal_relinearize=%s balance_reductions=%s: cost %g, N = %u, "
+            "%zu primes",
+            result.options["rescaler"].c_str(),
+            result.options["lazy_relinearize"].c_str(),
+            result.options["optimal_relinearize"].c_str(),
+            result.options["balance_reductions"].c_str(), result.cost,
+            result.polyModulusDegree, result.primeCount);
+      } else {
+        log(Verbosity::Info,
+            "Autotuned rescaler=%s lazy_relinearize=%s "
+            "optimal_relinearize=%s balance_reductions=%s: failed with %s",
+            result.options["rescaler"].c_str(),
+            result.options["lazy_relinearize"].c_str(),
+            result.options["optimal_relinearize"].c_str(),
+            result.options["balance_reductions"].c_str(),
+            result.error.c_str());
+      }
+      report.push_back(std::move(result));
+    }
+
+    auto &[program, params, signature] = *compilations[best];
+    return std::make_tuple(std::move(program), std::move(params),
+                           std::move(signature), std::move(report));
+  }
 };
 
 } // namespace eva
@@ -37,6 +37,18 @@ CKKSConfig::CKKSConfig(
              "to default.",
              valueStr.c_str());
       }
+    } else if (option == "rescale_divisor") {
+      std::istringstream is(valueStr);
+      is >> rescaleDivisor;
+      if (is.bad()) {
+        throw std::runtime_error(
+            "Could not parse unsigned int in rescale_divisor=" + valueStr);
+      }
+      if (rescaleDivisor != 0 && (rescaleDivisor < 20 || rescaleDivisor > 60)) {
+        throw std::runtime_error(
+            "rescale_divisor must be 0 or between 20 and 60, but " + valueStr +
+            " was given");
+      }
     } else if (option == "lazy_relinearize") {
       std::istringstream is(valueStr);
       is >> std::boolalpha >> lazyRelinearize;
@@ -45,6 +57,14 @@ CKKSConfig::CKKSConfig(
              "default.",
              valueStr.c_str());
       }
+    } else if (option == "optimal_relinearize") {
+      std::istringstream is(valueStr);
+      is >> std::boolalpha >> optimalRelinearize;
+      if (is.bad()) {
+        warn("Could not parse boolean in optimal_relinearize=%s. Falling back "
+             "to default.",
+             valueStr.c_str());
+      }
     } else if (option == "security_level") {
       std::istringstream is(valueStr);
       is >> securityLevel;
@@ -59,6 +79,38 @@ CKKSConfig::CKKSConfig(
         throw std::runtime_error("Could not parse boolean in quantum_safe=" +
                                  valueStr);
       }
+    } else if (option == "tile_size") {
+      std::istringstream is(valueStr);
+      is >> tileSize;
+      if (is.bad()) {
+        throw std::runtime_error("Could not parse unsigned int in tile_size=" +
+                                 valueStr);
+      }
+      if ((tileSize & (tileSize - 1)) != 0) {
+        throw std::runtime_error("tile_size must be a power-of-two, but " +
+                                 valueStr + " was given");
+      }
+    } else if (option == "pack_instances") {
+      std::istringstream is(valueStr);
+      is >> std::boolalpha >> packInstances;
+      if (is.bad()) {
+        throw std::runtime_error("Could not parse boolean in pack_instances=" +
+                                 valueStr);
+      }
+    } else if (option == "complex_packing") {
+      std::istringstream is(valueStr);
+      is >> std::boolalpha >> complexPacking;
+      if (is.bad()) {
+        throw std::runtime_error("Could not parse boolean in complex_packing=" +
+                                 valueStr);
+      }
+    } else if (option == "max_rotation_keys") {
+      std::istringstream is(valueStr);
+      is >> maxRotationKeys;
+      if (is.bad()) {
+        throw std::runtime_error(
+            "Could not parse unsigned int in max_rotation_keys=" + valueStr);
+      }
     } else if (option == "warn_vec_size") {
       std::istringstream is(valueStr);
       is >> std::boolalpha >> warnVecSize;
@@ -67,6 +119,8 @@ CKKSConfig::CKKSConfig(
              "back to default.",
              valueStr.c_str());
       }
+    } else if (option == "cache_dir") {
+      cacheDir = valueStr;
     } else {
       warn("Unknown option %s. Available options are:\n%s", option.c_str(),
            OPTIONS_HELP_MESSAGE);
@@ -96,13 +150,27 @@ std::string CKKSConfig::toString(int indent) const {
     break;
   }
   s << '\n';
+  s << indentStr << "rescale_divisor = " << rescaleDivisor;
+  s << '\n';
   s << indentStr << "lazy_relinearize = " << lazyRelinearize;
   s << '\n';
+  s << indentStr << "optimal_relinearize = " << optimalRelinearize;
+  s << '\n';
   s << indentStr << "security_level = " << securityLevel;
   s << '\n';
   s << indentStr << "quantum_safe = " << quantumSafe;
   s << '\n';
+  s << indentStr << "tile_size = " << tileSize;
+  s << '\n';
+  s << indentStr << "pack_instances = " << packInstances;
+  s << '\n';
+  s << indentStr << "complex_packing = " << complexPacking;
+  s << '\n';
+  s << indentStr << "max_rotation_keys = " << maxRotationKeys;
+  s << '\n';
   s << indentStr << "warn_vec_size = " << warnVecSize;
+  s << '\n';
+  s << indentStr << "cache_dir = " << cacheDir;
   return s.str();
 }
 
@@ -10,12 +10,19 @@ namespace eva {
 
 // clang-format off
 const char *const OPTIONS_HELP_MESSAGE =
-    "balance_reductions - Balance trees of mul, add or sub operations. bool (default=true)\n"
-    "rescaler           - Rescaling policy. One of: lazy_waterline (default), eager_waterline, always, minimum\n"
-    "lazy_relinearize   - Relinearize as late as possible. bool (default=true)\n"
-    "security_level     - How many bits of security parameters should be selected for. int (default=128)\n"
-    "quantum_safe       - Select quantum safe parameters. bool (default=false)\n"
-    "warn_vec_size      - Warn about possibly inefficient vector size selection. bool (default=true)";
+    "balance_reductions  - Balance trees of mul, add or sub operations. bool (default=true)\n"
+    "rescaler            - Rescaling policy. One of: lazy_waterline (default), eager_waterline, always, minimum\n"
+    "rescale_divisor     - Bits to divide the scale by in each rescale inserted by the waterline and minimum rescalers, between 20 and 60. 0 compiles with each divisor and picks the one with the lowest estimated cost. int (default=60)\n"
+    "lazy_relinearize    - Relinearize as late as possible. bool (default=true)\n"
+    "optimal_relinearize - Place relinearizations at a minimum cut between their cost and the cost of larger ciphertexts. Overrides lazy_relinearize. bool (default=false)\n"
+    "security_level      - How many bits of security parameters should be selected for. int (default=128)\n"
+    "quantum_safe        - Select quantum safe parameters. bool (default=false)\n"
+    "tile_size           - Split vectors larger than this into tiles of this size, e.g., half the polynomial degree required for security. 0 disables tiling. int (default=0)\n"
+    "pack_instances      - Pack independent instances of the inputs into the slots that would otherwise hold replicas of vectors smaller than the slot count. bool (default=false)\n"
+    "complex_packing     - Process two instances at once in the real and imaginary parts of the slots, if the program is linear in its inputs. bool (default=false)\n"
+    "max_rotation_keys   - Maximum number of rotation keys. Other rotations are decomposed into several rotations. 0 is unlimited. int (default=0)\n"
+    "warn_vec_size       - Warn about possibly inefficient vector size selection. bool (default=true)\n"
+    "cache_dir           - Directory for caching compilation results. Caching is disabled if empty. string (default=\"\")";
 // clang-format on
 
 enum class CKKSRescaler { LazyWaterline, EagerWaterline, Always, Minimum };
@@ -30,12 +37,27 @@ public:
 
   bool balanceReductions = true;
   CKKSRescaler rescaler = CKKSRescaler::LazyWaterline;
+  // Searches for the divisor with the lowest estimated cost when zero
+  uint32_t rescaleDivisor = 60;
   bool lazyRelinearize = true;
+  // Weighs relinearizations against operating on size 3 ciphertexts
+  bool optimalRelinearize = false;
   uint32_t securityLevel = 128;
   bool quantumSafe = false;
+  // Trades rotation key memory for additional rotations when nonzero
+  uint32_t maxRotationKeys = 0;
+  // Splits larger vectors across several ciphertexts when nonzero
+  uint32_t tileSize = 0;
+  // Fills the slots of each ciphertext with independent instances
+  bool packInstances = false;
+  // Uses the imaginary parts of the slots for a second instance
+  bool complexPacking = false;
 
   // Warnings
   bool warnVecSize = true;
+
+  // Caching
+  std::string cacheDir;
 };
 
 } // namespace eva
@@ -6,6 +6,7 @@
 #include "eva/ir/types.h"
 #include "eva/serialization/ckks.pb.h"
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 
@@ -25,10 +26,24 @@ struct CKKSEncodingInfo {
 struct CKKSSignature {
   int vecSize;
   std::unordered_map<std::string, CKKSEncodingInfo> inputs;
+  // Inputs that no output depends on. These do not need to be encrypted.
+  std::set<std::string> unusedInputs;
+  // Number of tiles of vecSize elements each input and output is split into.
+  // The tiles of x are named x#0, x#1, ... in the compiled program.
+  int tiles;
+  // Number of independent instances packed into consecutive blocks of vecSize
+  // slots. Inputs and outputs hold the instances one after another.
+  int instances;
+  // Whether the imaginary parts of the slots hold as many instances again.
+  // These follow the instances held by the real parts in inputs and outputs.
+  bool complexPacked;
 
   CKKSSignature(int vecSize,
-                std::unordered_map<std::string, CKKSEncodingInfo> inputs)
-      : vecSize(vecSize), inputs(inputs) {}
+                std::unordered_map<std::string, CKKSEncodingInfo> inputs,
+                std::set<std::string> unusedInputs = {}, int tiles = 1,
+                int instances = 1, bool complexPacked = false)
+      : vecSize(vecSize), inputs(inputs), unusedInputs(unusedInputs),
+        tiles(tiles), instances(instances), complexPacked(complexPacked) {}
 };
 
 std::unique_ptr<msg::CKKSSignature> serialize(const CKKSSignature &);
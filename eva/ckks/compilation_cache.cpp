@@ -0,0 +1,114 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "eva/ckks/compilation_cache.h"
+#include "eva/serialization/known_type.pb.h"
+#include "eva/util/logging.h"
+#include "eva/version.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+
+using namespace std;
+
+namespace eva {
+
+namespace {
+
+// Reads an object saved in the same format as save in
+// eva/serialization/save_load.h. Entries written by other versions of EVA are
+// ignored, because the compiler may have changed in between.
+template <class Msg> bool readKnownType(const string &path, Msg &inner) {
+  ifstream in(path, ios::binary);
+  if (in.fail()) {
+    return false;
+  }
+  msg::KnownType msg;
+  if (!msg.ParseFromIstream(&in)) {
+    return false;
+  }
+  if (msg.creator() != "EVA " + version()) {
+    return false;
+  }
+  return msg.contents().UnpackTo(&inner);
+}
+
+template <class T> void writeKnownType(const string &path, const T &obj) {
+  msg::KnownType msg;
+  msg.set_creator("EVA " + version());
+  msg.mutable_contents()->PackFrom(*serialize(obj));
+
+  // Write into a temporary file and move it in place, so that concurrent
+  // compilations never observe partially written entries
+  auto tmpPath = path + ".tmp" + to_string(random_device()());
+  {
+    ofstream out(tmpPath, ios::binary);
+    if (out.fail() || !msg.SerializeToOstream(&out)) {
+      throw runtime_error("Could not write " + tmpPath);
+    }
+  }
+  if (rename(tmpPath.c_str(), path.c_str()) != 0) {
+    remove(tmpPath.c_str());
+    throw runtime_error("Could not move " + tmpPath + " to " + path);
+  }
+}
+
+} // namespace
+
+string CompilationCache::getPath(uint64_t key, const string &extension) const {
+  char name[17];
+  snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+  return (filesystem::path(directory) / (name + extension)).string();
+}
+
+optional<CompilationCache::Entry>
+CompilationCache::load(uint64_t key, const Program &input) const {
+  msg::Program inputMsg;
+  msg::Program programMsg;
+  msg::CKKSParameters paramsMsg;
+  msg::CKKSSignature signatureMsg;
+  // The signature is written last, so check it first
+  if (!readKnownType(getPath(key, ".evasignature"), signatureMsg) ||
+      !readKnownType(getPath(key, ".evaparams"), paramsMsg) ||
+      !readKnownType(getPath(key, ".eva"), programMsg) ||
+      !readKnownType(getPath(key, ".evainput"), inputMsg)) {
+    return nullopt;
+  }
+  // Keys may collide, so only use the entry if it was compiled from the same
+  // program. Programs are saved in an order that only depends on their
+  // structure and the Program message has no map fields, so the same program
+  // serializes to the same bytes in every process.
+  if (inputMsg.SerializeAsString() != serialize(input)->SerializeAsString()) {
+    return nullopt;
+  }
+  try {
+    auto program = deserialize(programMsg);
+    auto params = deserialize(paramsMsg);
+    auto signature = deserialize(signatureMsg);
+    return make_tuple(move(program), move(*params), move(*signature));
+  } catch (const runtime_error &e) {
+    warn("Ignoring invalid compilation cache entry %s: %s",
+         getPath(key, "").c_str(), e.what());
+    return nullopt;
+  }
+}
+
+void CompilationCache::store(uint64_t key, const Program &input,
+                             const Program &program,
+                             const CKKSParameters &params,
+                             const CKKSSignature &signature) const {
+  try {
+    filesystem::create_directories(directory);
+    writeKnownType(getPath(key, ".evainput"), input);
+    writeKnownType(getPath(key, ".eva"), program);
+    writeKnownType(getPath(key, ".evaparams"), params);
+    writeKnownType(getPath(key, ".evasignature"), signature);
+  } catch (const exception &e) {
+    // Failing to cache should not fail the compilation
+    warn("Could not store compilation result in cache: %s", e.what());
+  }
+}
+
+} // namespace eva
@@ -0,0 +1,46 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ckks/ckks_parameters.h"
+#include "eva/ckks/ckks_signature.h"
+#include "eva/ir/program.h"
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+
+namespace eva {
+
+/*
+Stores results of CKKSCompiler::compile in a directory. Each entry is keyed by
+a hash of the input program and the compiler configuration and consists of
+three files <key>.eva, <key>.evaparams and <key>.evasignature in the same
+format as written by save, so cached entries can also be loaded directly. The
+input program is saved alongside as <key>.evainput and compared on load, so an
+entry is never returned for a different program with a colliding key.
+*/
+class CompilationCache {
+public:
+  using Entry =
+      std::tuple<std::unique_ptr<Program>, CKKSParameters, CKKSSignature>;
+
+  CompilationCache(std::string directory) : directory(std::move(directory)) {}
+
+  // Returns the cached entry for compiling input with key or nothing if it is
+  // not in the cache
+  std::optional<Entry> load(std::uint64_t key, const Program &input) const;
+
+  void store(std::uint64_t key, const Program &input, const Program &program,
+             const CKKSParameters &params,
+             const CKKSSignature &signature) const;
+
+private:
+  std::string directory;
+
+  std::string getPath(std::uint64_t key, const std::string &extension) const;
+};
+
+} // namespace eva
@@ -0,0 +1,111 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ckks/ckks_parameters.h"
+#include "eva/ckks/scale_level_cache.h"
+#include "eva/common/type_deducer.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+
+namespace eva {
+
+/*
+Estimates the cost of executing a compiled program with SEAL under the given
+encryption parameters, in units of about one operation on a 64 bit word. Each
+ciphertext or plaintext at level l has one residue polynomial of N coefficients
+for each of the remaining primes, and operations are costed as
+
+  Add, Sub, Negate        N per polynomial and prime
+  Mul                     N per pair of multiplied polynomials and prime
+  Encode                  one NTT of N log N per prime
+  Rescale                 one NTT per prime for each of the two polynomials
+  ModSwitch               a copy of the remaining primes of both polynomials,
+                          made once for a chain of consecutive ModSwitches
+  Relinearize, Rotate     key switching, which needs one NTT for each of the
+                          remaining primes and the special prime, for each
+                          prime of the decomposed polynomial
+
+The estimate is only meant to compare compilations of the same program, as the
+constant factors of the actual operations differ. Use with a forward pass over
+the compiled program, and then take the total with getCost.
+*/
+class CostEstimator {
+  Program &program;
+  TermMap<Type> types;
+  ScaleLevelCache levels;
+  TypeDeducer typeDeducer;
+  double n;
+  double ntt;
+  std::uint32_t dataPrimes;
+  double cost = 0;
+
+  double keySwitch(double primes) { return primes * (primes + 1) * ntt; }
+
+public:
+  CostEstimator(Program &g, const CKKSParameters &params)
+      : program(g), types(g), levels(g), typeDeducer(g, types),
+        n(params.polyModulusDegree),
+        ntt(params.polyModulusDegree * std::log2(params.polyModulusDegree)) {
+    // The last prime is the special prime used in key switching
+    if (params.primeBits.empty()) {
+      throw std::runtime_error("Cannot estimate costs for parameters without "
+                               "any primes");
+    }
+    dataPrimes = params.primeBits.size() - 1;
+  }
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    typeDeducer(term);
+
+    if (types[term] == Type::Raw) return;
+    auto level = levels.getLevel(term);
+    double primes = dataPrimes > level ? dataPrimes - level : 1;
+    std::size_t ciphers = 0;
+    for (auto &operand : term->getOperands()) {
+      if (types[operand] == Type::Cipher) ++ciphers;
+    }
+
+    switch (term->op) {
+    case Op::Add:
+    case Op::Sub:
+    case Op::Negate:
+      cost += 2 * n * primes;
+      break;
+    case Op::Mul:
+      cost += (ciphers > 1 ? 4 : 2) * n * primes;
+      break;
+    case Op::Encode:
+      cost += ntt * primes;
+      break;
+    case Op::Rescale:
+      cost += 2 * ntt * (primes + 1);
+      break;
+    case Op::ModSwitch:
+      if (term->numUses() == 1 && term->getUses()[0]->op == Op::ModSwitch) {
+        break;
+      }
+      cost += 2 * n * primes;
+      break;
+    case Op::Relinearize:
+      cost += keySwitch(primes);
+      break;
+    case Op::RotateLeftConst:
+    case Op::RotateRightConst:
+      cost += keySwitch(primes) + 2 * n * primes;
+      break;
+    default:
+      break;
+    }
+  }
+
+  double getCost() { return cost; }
+};
+
+} // namespace eva
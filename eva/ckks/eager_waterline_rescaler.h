@@ -10,12 +10,13 @@ namespace eva {
 
 class EagerWaterlineRescaler : public Rescaler {
   std::uint32_t minScale;
-  const std::uint32_t fixedRescale = 60;
+  std::uint32_t fixedRescale;
 
 public:
   EagerWaterlineRescaler(Program &g, TermMap<Type> &type,
-                         TermMapOptional<std::uint32_t> &scale)
-      : Rescaler(g, type, scale) {
+                         TermMapOptional<std::uint32_t> &scale,
+                         std::uint32_t fixedRescale = 60)
+      : Rescaler(g, type, scale), fixedRescale(fixedRescale) {
     // ASSUME: minScale is max among all the inputs' scale
     minScale = 0;
     for (auto &source : program.getSources()) {
@@ -52,16 +53,7 @@ public:
                 "at scale %i",
                 operand->index, scale[operand], maxScale);
 
-            auto scaleConstant = program.makeUniformConstant(1);
-            scale[scaleConstant] = maxScale - scale[operand];
-            scaleConstant->set<EncodeAtScaleAttribute>(scale[scaleConstant]);
-
-            auto mulNode = program.makeTerm(Op::Mul, {operand, scaleConstant});
-            scale[mulNode] = maxScale;
-
-            // TODO: Not obviously correct as it's modifying inside
-            // iteration. Refine API to make this less surprising.
-            term->replaceOperand(operand, mulNode);
+            scaleUpOperand(term, operand, maxScale);
           }
         }
         // assert that all operands have the same scale
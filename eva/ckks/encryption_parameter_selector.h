@@ -3,19 +3,25 @@
 
 #pragma once
 
+#include "eva/ckks/scale_level_cache.h"
 #include "eva/ir/program.h"
 #include "eva/ir/term_map.h"
+#include "eva/util/logging.h"
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
 #include <vector>
 
 namespace eva {
 
 class EncryptionParametersSelector {
 public:
-  EncryptionParametersSelector(Program &g,
-                               TermMapOptional<std::uint32_t> &scales,
+  EncryptionParametersSelector(Program &g, ScaleLevelCache &scales,
                                TermMap<Type> &types)
       : program_(g), scales_(scales), terms_(g), types(types) {}
 
@@ -48,6 +54,12 @@ public:
     }
     auto &operands = term->getOperands();
 
+    // Remember the smallest scale that key switching adds noise to
+    if (isKeySwitchingOp(term->op) && types[term] == Type::Cipher) {
+      minKeySwitchingScale =
+          std::min(minKeySwitchingScale, scales_.getScale(term->operandAt(0)));
+    }
+
     // Nothing to do for inputs
     if (operands.size() > 0) {
       // Get the parameters for this term
@@ -123,7 +135,7 @@ public:
       // The size for this output term equals the range attribute (bits) plus
       // the scale (bits)
       auto size = output->get<RangeAttribute>();
-      size += scales_[output];
+      size += scales_.getScale(output);
 
       // Update maxOutputSize
       if (size > maxOutputSize) maxOutputSize = size;
@@ -189,22 +201,156 @@ public:
       }
     }
 
-    // Add maxParm to result parameters; this is the "key prime".
-    // TODO: This might be too aggressive. We can try smaller primes here as
-    // well, which in some cases is advantageous as it may result in smaller
-    // poly_modulus_degree, even though the noise growth may be a bit larger.
+    // Add maxParm to result parameters; this is the "key prime". Smaller key
+    // primes are tried by selectEncryptionParameters.
     parms.push_back(maxParm);
 
     return parms;
   }
 
+  // Searches for the primes that need the smallest poly_modulus_degree under
+  // the security level given by maxBitsFun, starting from the primes returned
+  // by getEncryptionParameters. Two choices are varied:
+  //
+  //   - The primes holding the outputs, which need only add up to the size of
+  //     the outputs and are not rounded up to the largest rescaling prime. The
+  //     outputs are split evenly between as few primes as possible.
+  //   - The key prime, which may be smaller than the largest data prime. Key
+  //     switching, as done by relinearization and rotations, then adds about
+  //     as many more bits of noise as the difference. Key switching noise is
+  //     kept keySwitchingPrecision bits below the smallest scale of any key
+  //     switched ciphertext, and is irrelevant for programs without any.
+  //
+  // Among the choices with the smallest degree the one with the least noise
+  // is taken, preferring the primes of getEncryptionParameters. The degree
+  // and noise of each choice are logged.
+  std::vector<std::uint32_t>
+  selectEncryptionParameters(int (*maxBitsFun)(std::size_t)) {
+    auto defaultParms = getEncryptionParameters();
+    std::size_t rescaleCount = 0;
+    std::uint32_t maxOutputSize = 0;
+    for (auto &entry : program_.getOutputs()) {
+      auto &output = entry.second;
+      rescaleCount = std::max(rescaleCount, terms_[output].size());
+      maxOutputSize = std::max(maxOutputSize, output->get<RangeAttribute>() +
+                                                  scales_.getScale(output));
+    }
+    auto rescaleBegin = defaultParms.end() - 1 - rescaleCount;
+    std::vector<std::uint32_t> rescalePrimes(rescaleBegin,
+                                             defaultParms.end() - 1);
+
+    // Output primes are at most 60 bits as required by SEAL, and at least 20
+    // bits as before
+    std::vector<std::vector<std::uint32_t>> outputLayouts;
+    outputLayouts.emplace_back(defaultParms.begin(), rescaleBegin);
+    std::uint32_t outputPrimeCount = (maxOutputSize + 59) / 60;
+    std::uint32_t evenBits =
+        (maxOutputSize + outputPrimeCount - 1) / outputPrimeCount;
+    std::vector<std::uint32_t> evenLayout(outputPrimeCount,
+                                          std::max(20u, evenBits));
+    if (evenLayout != outputLayouts.front()) {
+      outputLayouts.push_back(evenLayout);
+    }
+
+    // Candidates are compared by degree, noise, layout and key prime size
+    using Candidate =
+        std::tuple<std::size_t, std::uint32_t, std::size_t, std::uint32_t>;
+    Candidate best(std::numeric_limits<std::size_t>::max(), 0, 0, 0);
+    for (std::size_t layout = 0; layout < outputLayouts.size(); ++layout) {
+      auto &outputPrimes = outputLayouts[layout];
+      std::uint32_t dataBits = 0;
+      std::uint32_t maxDataPrime = 0;
+      for (auto &primes : {outputPrimes, rescalePrimes}) {
+        for (auto bits : primes) {
+          dataBits += bits;
+          maxDataPrime = std::max(maxDataPrime, bits);
+        }
+      }
+
+      std::size_t previousDegree = 0;
+      for (std::uint32_t keyBits = std::max(20u, std::min(60u, maxDataPrime));
+           keyBits >= 20; --keyBits) {
+        auto degree = getMinDegree(maxBitsFun, dataBits + keyBits);
+        if (degree == 0) continue;
+        std::uint32_t noise =
+            maxDataPrime > keyBits ? maxDataPrime - keyBits : 0;
+        if (noise > 0 && hasKeySwitching() &&
+            minKeySwitchingScale < std::log2(degree) + noise +
+                                       keySwitchingPrecision) {
+          continue;
+        }
+        if (degree != previousDegree) {
+          log(Verbosity::Debug,
+              "Output primes %s with a %u bit key prime need N = %zu and add "
+              "%u bits of key switching noise",
+              join(outputPrimes).c_str(), keyBits, degree,
+              hasKeySwitching() ? noise : 0);
+          previousDegree = degree;
+        }
+        Candidate candidate(degree, hasKeySwitching() ? noise : 0, layout,
+                            60 - keyBits);
+        best = std::min(best, candidate);
+      }
+    }
+
+    auto &[degree, noise, layout, keyPrimeDeficit] = best;
+    if (degree == std::numeric_limits<std::size_t>::max()) {
+      // No choice is secure; leave reporting the error to the caller
+      return defaultParms;
+    }
+    std::vector<std::uint32_t> parms = outputLayouts[layout];
+    parms.insert(parms.end(), rescalePrimes.begin(), rescalePrimes.end());
+    parms.push_back(60 - keyPrimeDeficit);
+    if (parms != defaultParms) {
+      log(Verbosity::Info,
+          "Selected primes %s instead of %s for N = %zu with %u bits of "
+          "additional key switching noise",
+          join(parms).c_str(), join(defaultParms).c_str(), degree, noise);
+    }
+    return parms;
+  }
+
 private:
   Program &program_;
-  TermMapOptional<std::uint32_t> &scales_;
+  ScaleLevelCache &scales_;
   TermMap<std::vector<std::uint32_t>> terms_;
   TermMap<Type> &types;
+  std::uint32_t minKeySwitchingScale =
+      std::numeric_limits<std::uint32_t>::max();
+
+  // Bits of precision kept above key switching noise when the key prime is
+  // smaller than the data primes
+  static constexpr std::uint32_t keySwitchingPrecision = 20;
 
   inline bool isRescaleOp(const Op &op_code) { return op_code == Op::Rescale; }
+
+  inline bool isKeySwitchingOp(const Op &op_code) {
+    return op_code == Op::Relinearize || op_code == Op::RotateLeftConst ||
+           op_code == Op::RotateRightConst;
+  }
+
+  bool hasKeySwitching() {
+    return minKeySwitchingScale != std::numeric_limits<std::uint32_t>::max();
+  }
+
+  // Returns zero if no degree allows for bitCount bits
+  std::size_t getMinDegree(int (*maxBitsFun)(std::size_t),
+                           std::uint32_t bitCount) {
+    for (std::size_t degree = 1024;; degree *= 2) {
+      auto maxBits = maxBitsFun(degree);
+      if (maxBits == 0) return 0;
+      if (std::uint32_t(maxBits) >= bitCount) return degree;
+    }
+  }
+
+  std::string join(const std::vector<std::uint32_t> &primes) {
+    std::string result;
+    for (auto bits : primes) {
+      if (!result.empty()) result += ",";
+      result += std::to_string(bits);
+    }
+    return "{" + result + "}";
+  }
 };
 
 } // namespace eva
@@ -10,7 +10,7 @@ namespace eva {
 
 class LazyWaterlineRescaler : public Rescaler {
   std::uint32_t minScale;
-  const std::uint32_t fixedRescale = 60;
+  std::uint32_t fixedRescale;
   TermMap<bool> pending; // maintains whether rescaling is pending
   // TODO: level is no longer used. Should be removed.
   TermMap<std::uint32_t> level; // maintains the number of rescalings (levels)
@@ -30,8 +30,10 @@ class LazyWaterlineRescaler : public Rescaler {
 
 public:
   LazyWaterlineRescaler(Program &g, TermMap<Type> &type,
-                        TermMapOptional<std::uint32_t> &scale)
-      : Rescaler(g, type, scale), pending(g), level(g) {
+                        TermMapOptional<std::uint32_t> &scale,
+                        std::uint32_t fixedRescale = 60)
+      : Rescaler(g, type, scale), fixedRescale(fixedRescale), pending(g),
+        level(g) {
     // ASSUME: minScale is max among all the inputs' scale
     minScale = 0;
     for (auto &source : program.getSources()) {
@@ -107,14 +109,7 @@ public:
                 "at scale %i",
                 operand->index, scale[operand], maxScale);
 
-            auto scaleConstant = program.makeUniformConstant(1);
-            scale[scaleConstant] = maxScale - scale[operand];
-            scaleConstant->set<EncodeAtScaleAttribute>(scale[scaleConstant]);
-
-            auto mulNode = program.makeTerm(Op::Mul, {operand, scaleConstant});
-            scale[mulNode] = maxScale;
-
-            term->replaceOperand(operand, mulNode);
+            scaleUpOperand(term, operand, maxScale);
           }
         }
         // assert that all operands have the same scale
@@ -314,15 +309,7 @@ isPlainType(type[rightOperand])){ type[newOperand] = Type::Plain;
     // ensure that all operands have same scale
     for (auto &operand : operands) {
       if (scale[operand] < maxScale) {
-        auto scaleConstant = program.makeUniformConstant(1);
-        scale[scaleConstant] = maxScale - scale[operand];
-        scaleConstant->set<EncodeAtScaleAttribute>(scale[scaleConstant]);
-        auto mulNode = program.makeTerm(Op::Mul, {operand, scaleConstant});
-        scale[mulNode] = maxScale;
-
-        // TODO: Not obviously correct as it's modifying inside
-        // iteration. Refine API to make this less surprising.
-        term->replaceOperand(operand, mulNode);
+        scaleUpOperand(term, operand, maxScale);
       }
     }
     // assert that all operands have the same scale
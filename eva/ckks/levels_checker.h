@@ -3,52 +3,41 @@
 
 #pragma once
 
+#include "eva/ckks/scale_level_cache.h"
 #include "eva/ir/program.h"
 #include "eva/ir/term_map.h"
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <optional>
 
 namespace eva {
 
 class LevelsChecker {
 public:
-  LevelsChecker(Program &g, TermMap<Type> &types)
-      : program_(g), types_(types), levels_(g) {}
+  LevelsChecker(Program &g, TermMap<Type> &types, ScaleLevelCache &levels)
+      : program_(g), types_(types), levels_(levels) {}
 
   void operator()(const Term::Ptr &term) {
-    // This function verifies that the levels are compatibile. It assumes the
-    // operand terms are processed already, so it must only be used with forward
-    // pass traversal.
-
-    if (term->numOperands() == 0) {
-      // If this is a source node, get the encoding level
-      levels_[term] = term->get<EncodeAtLevelAttribute>();
-    } else {
-      // For other terms, the operands must all have matching level. First find
-      // the level of any of the ciphertext operands.
-      std::size_t operandLevel;
-      for (auto &operand : term->getOperands()) {
-        if (types_[operand] == Type::Cipher) {
-          operandLevel = levels_[operand];
-          break;
-        }
-      }
-
-      // Next verify that all operands have the same level.
-      for (auto &operand : term->getOperands()) {
-        if (types_[operand] == Type::Cipher) {
-          auto operandLevel2 = levels_[operand];
-          assert(operandLevel == operandLevel2);
-        }
+    // This function verifies that the levels are compatibile. The levels
+    // themselves come from the cache.
+
+    // The operands must all have matching level. First find the level of any
+    // of the ciphertext operands.
+    std::optional<std::uint32_t> operandLevel;
+    for (auto &operand : term->getOperands()) {
+      if (types_[operand] == Type::Cipher) {
+        operandLevel = levels_.getLevel(operand);
+        break;
       }
+    }
 
-      // Incremenet the level for a rescale or modulus switch
-      std::size_t level = operandLevel;
-      if (isRescaleOp(term->op) || isModSwitchOp(term->op)) {
-        ++level;
+    // Next verify that all operands have the same level.
+    for (auto &operand : term->getOperands()) {
+      if (types_[operand] == Type::Cipher) {
+        auto operandLevel2 = levels_.getLevel(operand);
+        assert(operandLevel == operandLevel2);
       }
-      levels_[term] = level;
     }
   }
 
@@ -61,11 +50,7 @@ private:
   TermMap<Type> &types_;
 
   // Maintains the reverse level (leaves have 0, roots have max)
-  TermMap<std::size_t> levels_;
-
-  bool isModSwitchOp(const Op &op_code) { return (op_code == Op::ModSwitch); }
-
-  bool isRescaleOp(const Op &op_code) { return (op_code == Op::Rescale); }
+  ScaleLevelCache &levels_;
 };
 
 } // namespace eva
@@ -0,0 +1,125 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "eva/ckks/noise_simulating_executor.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+namespace eva {
+
+namespace {
+
+// The standard deviation of errors in SEAL's keys
+const double keyErrorStandardDeviation = 3.2;
+
+} // namespace
+
+NoiseSimulatingExecutor::NoiseSimulatingExecutor(Program &g,
+                                                 const CKKSParameters &params,
+                                                 uint64_t seed)
+    : ReferenceExecutor(g), types_(g), typeDeducer_(g, types_), scales_(g),
+      levels_(g), primeBits_(params.primeBits),
+      degree_(params.polyModulusDegree), random_(seed) {
+  // The last prime is the special prime used in key switching
+  if (primeBits_.empty()) {
+    throw runtime_error("Cannot simulate noise for parameters without any "
+                        "primes");
+  }
+}
+
+double NoiseSimulatingExecutor::roundingVariance() {
+  // The secret key is ternary with two thirds of its coefficients non-zero
+  return (1 + degree_ * 2 / 3) / 12;
+}
+
+double NoiseSimulatingExecutor::keySwitchingVariance(uint32_t level) {
+  // Each remaining data prime contributes a uniformly random polynomial
+  // modulo it multiplied with a key error, all divided by the special prime
+  size_t dataPrimes = primeBits_.size() - 1;
+  size_t remaining = dataPrimes - min<size_t>(level, dataPrimes);
+  double variance = 0;
+  for (size_t i = 0; i < remaining; ++i) {
+    variance += pow(2.0, 2.0 * primeBits_[i]) / 12 * degree_ *
+                keyErrorStandardDeviation * keyErrorStandardDeviation;
+  }
+  variance /= pow(2.0, 2.0 * primeBits_.back());
+  return variance + roundingVariance();
+}
+
+void NoiseSimulatingExecutor::addNoise(const Term::Ptr &term,
+                                       double coefficientVariance) {
+  // The real part of each slot sums up N coefficients
+  double deviation = sqrt(degree_ / 2 * coefficientVariance);
+  normal_distribution<double> distribution(
+      0, ldexp(deviation, -int(scales_[term])));
+  for (auto &value : terms_[term]) {
+    value += distribution(random_);
+  }
+}
+
+void NoiseSimulatingExecutor::operator()(const Term::Ptr &term) {
+  // Must only be used with forward pass traversal
+  auto deduced = term;
+  typeDeducer_(deduced);
+  ReferenceExecutor::operator()(term);
+
+  auto &scale = scales_[term];
+  auto &level = levels_[term];
+  if (term->has<EncodeAtScaleAttribute>()) {
+    scale = term->get<EncodeAtScaleAttribute>();
+  } else {
+    for (auto &operand : term->getOperands()) {
+      if (types_[operand] == Type::Raw) continue;
+      if (term->op == Op::Mul) {
+        scale += scales_[operand];
+      } else {
+        scale = max(scale, scales_[operand]);
+      }
+    }
+  }
+  if (term->has<EncodeAtLevelAttribute>()) {
+    level = term->get<EncodeAtLevelAttribute>();
+  } else {
+    for (auto &operand : term->getOperands()) {
+      level = max(level, levels_[operand]);
+    }
+  }
+
+  double encodingVariance = 1.0 / 12;
+  switch (term->op) {
+  case Op::Input:
+    if (types_[term] == Type::Cipher) {
+      addNoise(term, encodingVariance + roundingVariance());
+    } else if (types_[term] == Type::Plain) {
+      addNoise(term, encodingVariance);
+    }
+    break;
+  case Op::Encode:
+    addNoise(term, encodingVariance);
+    break;
+  case Op::Rescale:
+    scale -= term->get<RescaleDivisorAttribute>();
+    ++level;
+    if (types_[term] == Type::Cipher) {
+      addNoise(term, roundingVariance());
+    }
+    break;
+  case Op::ModSwitch:
+    ++level;
+    break;
+  case Op::Relinearize:
+  case Op::RotateLeftConst:
+  case Op::RotateRightConst:
+    if (types_[term] == Type::Cipher) {
+      addNoise(term, keySwitchingVariance(level));
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+} // namespace eva
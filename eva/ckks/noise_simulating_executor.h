@@ -0,0 +1,61 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ckks/ckks_parameters.h"
+#include "eva/common/reference_executor.h"
+#include "eva/common/type_deducer.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace eva {
+
+/*
+Executes a compiled program without encryption like ReferenceExecutor, but adds
+to the values the error that CKKS with the given encryption parameters is
+expected to introduce, so that the precision of the outputs can be estimated
+without generating keys or encrypting anything. Errors are drawn from normal
+distributions whose variances model SEAL's implementation:
+
+  Encoding        rounding of each coefficient to an integer
+  Encryption      rounding when the special prime is divided out, which
+                  multiplies the rounding error with the secret key
+  Rescale         the same rounding when dividing by the dropped prime
+  Relinearize,    the product of the decomposed ciphertext with the key
+  Rotate          switching key errors, divided by the special prime, and
+                  then the rounding of that division
+
+The variance of a coefficient becomes N times larger in each slot, and it is
+relative to the scale of the term. Additions, multiplications and rotations
+propagate the errors that are already in the values. ModSwitch drops a prime
+exactly and adds no error. Use with a forward pass over a compiled program.
+*/
+class NoiseSimulatingExecutor : public ReferenceExecutor {
+public:
+  NoiseSimulatingExecutor(Program &g, const CKKSParameters &params,
+                          std::uint64_t seed = 0);
+
+  void operator()(const Term::Ptr &term);
+
+private:
+  TermMap<Type> types_;
+  TypeDeducer typeDeducer_;
+  TermMap<std::uint32_t> scales_;
+  TermMap<std::uint32_t> levels_;
+  std::vector<std::uint32_t> primeBits_;
+  double degree_;
+  std::mt19937_64 random_;
+
+  // Variance of a coefficient after rounding a product with the secret key
+  double roundingVariance();
+
+  double keySwitchingVariance(std::uint32_t level);
+
+  void addNoise(const Term::Ptr &term, double coefficientVariance);
+};
+
+} // namespace eva
@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <queue>
+#include <set>
+#include <vector>
+
+namespace eva {
+
+/*
+Places relinearizations so that their total cost together with the extra cost
+of operating on size 3 ciphertexts is minimal. Multiplying two ciphertexts
+gives a ciphertext of size 3, which additions, subtractions, negations,
+multiplications by plaintexts and rescales can keep operating on, while
+multiplications of ciphertexts, rotations and outputs need it relinearized back
+to size 2. Each term that may hold a size 3 ciphertext becomes two nodes of a
+flow network, connected by an edge weighted with the cost of relinearizing the
+term. Edges from the products of ciphertexts are unbounded from the source, and
+the extra cost of each operation on a size 3 ciphertext is an edge to the sink,
+as are unbounded edges to uses that need size 2. A minimum cut then separates
+the terms left at size 3 from the rest, and its relinearization edges are where
+Relinearize terms go. Costs are in the units of CostEstimator, with the
+remaining primes of each term given by the rescales after it and the degree
+estimated from the vector size, as the encryption parameters are not known yet.
+Use with a forward pass after rescaling, and then call relinearize.
+*/
+class OptimalRelinearizer {
+  Program &program;
+  TermMap<Type> &type;
+  TermMapOptional<std::uint32_t> &scale;
+  TermMap<std::uint32_t> depths; // rescales on the deepest path to each term
+  std::vector<Term::Ptr> terms;
+
+  // Edges are stored in pairs, so that the reverse of edge e is e ^ 1
+  struct FlowNetwork {
+    struct Edge {
+      std::size_t to;
+      double capacity;
+    };
+    std::vector<Edge> edges;
+    std::vector<std::vector<std::size_t>> adjacent;
+    std::vector<std::size_t> distances;
+    std::vector<std::size_t> next;
+
+    FlowNetwork(std::size_t nodes) : adjacent(nodes) {}
+
+    void addEdge(std::size_t from, std::size_t to, double capacity) {
+      adjacent[from].push_back(edges.size());
+      edges.push_back({to, capacity});
+      adjacent[to].push_back(edges.size());
+      edges.push_back({from, 0});
+    }
+
+    bool hasCapacity(std::size_t e) { return edges[e].capacity > 1e-9; }
+
+    // Marks the nodes reachable from source in the residual network
+    bool findDistances(std::size_t source, std::size_t sink) {
+      distances.assign(adjacent.size(), SIZE_MAX);
+      distances[source] = 0;
+      std::queue<std::size_t> queue;
+      queue.push(source);
+      while (!queue.empty()) {
+        auto node = queue.front();
+        queue.pop();
+        for (auto e : adjacent[node]) {
+          if (hasCapacity(e) && distances[edges[e].to] == SIZE_MAX) {
+            distances[edges[e].to] = distances[node] + 1;
+            queue.push(edges[e].to);
+          }
+        }
+      }
+      return distances[sink] != SIZE_MAX;
+    }
+
+    // Finds a path from source to sink in the level graph with a depth first
+    // search, and pushes as much flow along it as its edges allow. Returns the
+    // amount pushed. The path is kept on an explicit stack, as it can be as
+    // long as the program is deep.
+    double push(std::size_t source, std::size_t sink) {
+      std::vector<std::size_t> path;
+      auto node = source;
+      while (node != sink) {
+        for (; next[node] < adjacent[node].size(); ++next[node]) {
+          auto e = adjacent[node][next[node]];
+          if (hasCapacity(e) && distances[edges[e].to] == distances[node] + 1) {
+            break;
+          }
+        }
+        if (next[node] < adjacent[node].size()) {
+          auto e = adjacent[node][next[node]];
+          path.push_back(e);
+          node = edges[e].to;
+          continue;
+        }
+        // Nothing reaches the sink from here, so retreat and skip the edge
+        // that led here from now on
+        if (path.empty()) return 0;
+        node = edges[path.back() ^ 1].to;
+        path.pop_back();
+        ++next[node];
+      }
+
+      double pushed = std::numeric_limits<double>::infinity();
+      for (auto e : path) {
+        pushed = std::min(pushed, edges[e].capacity);
+      }
+      for (auto e : path) {
+        edges[e].capacity -= pushed;
+        edges[e ^ 1].capacity += pushed;
+      }
+      return pushed;
+    }
+
+    // Dinic's algorithm. Leaves the source side of a minimum cut in distances.
+    void maximizeFlow(std::size_t source, std::size_t sink) {
+      while (findDistances(source, sink)) {
+        next.assign(adjacent.size(), 0);
+        double pushed;
+        do {
+          pushed = push(source, sink);
+        } while (pushed > 0);
+      }
+    }
+
+    bool isSourceSide(std::size_t node) {
+      return distances[node] != SIZE_MAX;
+    }
+  };
+
+  bool isEncryptedMultOp(const Term::Ptr &term) {
+    if (term->op != Op::Mul) return false;
+    for (auto &operand : term->getOperands()) {
+      if (type[operand] != Type::Cipher) return false;
+    }
+    return true;
+  }
+
+  // Ops that work on size 3 ciphertexts and keep them at size 3
+  bool keepsSize(const Term::Ptr &term) {
+    switch (term->op) {
+    case Op::Add:
+    case Op::Sub:
+    case Op::Negate:
+    case Op::Rescale:
+    case Op::ModSwitch:
+      return true;
+    case Op::Mul:
+      return !isEncryptedMultOp(term);
+    default:
+      return false;
+    }
+  }
+
+public:
+  OptimalRelinearizer(Program &g, TermMap<Type> &type,
+                      TermMapOptional<std::uint32_t> &scale)
+      : program(g), type(type), scale(scale), depths(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    std::uint32_t depth = 0;
+    for (auto &operand : term->getOperands()) {
+      depth = std::max(depth, depths[operand]);
+    }
+    if (term->op == Op::Rescale) ++depth;
+    depths[term] = depth;
+    terms.push_back(term);
+  }
+
+  void relinearize() {
+    std::uint32_t maxDepth = 0;
+    for (auto &term : terms) {
+      maxDepth = std::max(maxDepth, depths[term]);
+    }
+    double logDegree = std::max(12.0, std::log2(2.0 * program.getVecSize()));
+
+    // Find the terms that may hold size 3 ciphertexts. Terms are in
+    // topological order, so operands are decided before their uses.
+    TermMap<std::size_t> nodes(program);
+    std::vector<Term::Ptr> candidates;
+    for (auto &term : terms) {
+      if (type[term] != Type::Cipher) continue;
+      bool candidate = isEncryptedMultOp(term);
+      if (!candidate && keepsSize(term)) {
+        for (auto &operand : term->getOperands()) {
+          if (nodes[operand] != 0) candidate = true;
+        }
+      }
+      if (candidate) {
+        candidates.push_back(term);
+        nodes[term] = 2 * candidates.size(); // the first of its two nodes
+      }
+    }
+    if (candidates.empty()) return;
+
+    const std::size_t source = 0;
+    const std::size_t sink = 1;
+    const double unbounded = std::numeric_limits<double>::infinity();
+    FlowNetwork network(2 * candidates.size() + 2);
+    for (auto &term : candidates) {
+      auto in = nodes[term];
+      auto out = in + 1;
+      double primes = maxDepth - depths[term] + 1;
+      // Relinearizing switches keys for each prime of the decomposed
+      // polynomial, as in CostEstimator
+      network.addEdge(in, out, primes * (primes + 1) * logDegree);
+      if (isEncryptedMultOp(term)) {
+        network.addEdge(source, in, unbounded);
+      } else if (term->op == Op::Rescale) {
+        // The third polynomial needs its own NTTs
+        network.addEdge(in, sink, (primes + 1) * logDegree);
+      } else {
+        // Otherwise there is one more polynomial to add, multiply or copy
+        network.addEdge(in, sink, primes);
+      }
+      std::set<Term *> visited;
+      for (auto &use : term->getUses()) {
+        if (!visited.insert(use.get()).second) continue;
+        if (nodes[use] != 0 && keepsSize(use)) {
+          network.addEdge(out, nodes[use], unbounded);
+        } else {
+          network.addEdge(out, sink, unbounded);
+        }
+      }
+    }
+    network.maximizeFlow(source, sink);
+
+    for (auto &term : candidates) {
+      auto in = nodes[term];
+      if (!network.isSourceSide(in) || network.isSourceSide(in + 1)) continue;
+      auto relinNode = program.makeTerm(Op::Relinearize, {term});
+      type[relinNode] = type[term];
+      scale[relinNode] = scale[term];
+      term->replaceOtherUsesWith(relinNode);
+    }
+  }
+};
+
+} // namespace eva
@@ -46,6 +46,41 @@ protected:
     term2->replaceOperand(term1, rescaleNode);
   }
 
+  // Raises the scale of operand, which is used by term, to targetScale by
+  // multiplying with a one encoded at the difference. If operand is itself a
+  // multiplication by a constant used only here, the constant is encoded at a
+  // higher scale instead, which saves a multiplication.
+  void scaleUpOperand(Term::Ptr term, Term::Ptr operand,
+                      std::uint32_t targetScale) {
+    auto scaleBy = targetScale - scale[operand];
+    if (isMultiplicationOp(operand->op) && operand->numUses() == 1) {
+      for (auto &factor : operand->getOperands()) {
+        if (factor->op != Op::Constant) continue;
+        auto constant = program.makeTerm(Op::Constant);
+        constant->set<ConstantValueAttribute>(
+            factor->get<ConstantValueAttribute>());
+        type[constant] = Type::Raw;
+        scale[constant] = scale[factor] + scaleBy;
+        constant->set<EncodeAtScaleAttribute>(scale[constant]);
+
+        operand->replaceOperand(factor, constant);
+        scale[operand] = targetScale;
+        return;
+      }
+    }
+
+    auto scaleConstant = program.makeUniformConstant(1);
+    scale[scaleConstant] = scaleBy;
+    scaleConstant->set<EncodeAtScaleAttribute>(scale[scaleConstant]);
+
+    auto mulNode = program.makeTerm(Op::Mul, {operand, scaleConstant});
+    scale[mulNode] = targetScale;
+
+    // TODO: Not obviously correct as it's modifying inside iteration. Refine
+    // API to make this less surprising.
+    term->replaceOperand(operand, mulNode);
+  }
+
   void handleRawScale(Term::Ptr term) {
     if (term->numOperands() > 0) {
       int maxScale = 0;
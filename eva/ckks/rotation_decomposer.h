@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/common/rotation_keys_selector.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace eva {
+
+/*
+Limits the number of distinct rotation keys a program needs. Every distinct
+rotation step of a ciphertext needs its own Galois key, which can take hundreds
+of megabytes for large parameters. With a budget of maxKeys keys, rotations by
+steps without a key are decomposed into chains of rotations by steps with keys.
+
+The keys always include the powers r^i of the smallest power of two r for which
+these fit into the budget, so that every step can be decomposed. The remaining
+budget is filled greedily with the steps that save the most rotations, weighted
+by how often each step occurs in the program, and each step is then decomposed
+into the fewest rotations with a breadth-first search. Steps are taken modulo
+the vector size, as rotations of vectors are cyclic.
+
+Use count on every term first to gather the rotation steps, then selectKeys,
+and finally a forward pass to gather the rotations to decompose followed by
+decompose. The rewrite is deferred because the traversal does not reach the
+uses of a rotation once they are rewired to its decomposition.
+*/
+class RotationDecomposer {
+  Program &program;
+  TermMap<Type> &type;
+  TermMapOptional<std::uint32_t> &scale;
+  std::uint32_t maxKeys;
+  std::map<std::uint32_t, std::uint64_t> stepCounts;
+  std::set<std::uint32_t> keys;
+  // For each step the key the shortest decomposition ends with
+  std::vector<std::uint32_t> lastKey;
+  std::vector<std::uint32_t> distance;
+  std::vector<Term::Ptr> rotations;
+
+  bool isRotation(const Term::Ptr &term) {
+    return term->op == Op::RotateLeftConst || term->op == Op::RotateRightConst;
+  }
+
+  std::uint32_t getLeftStep(const Term::Ptr &rotation) {
+    std::int64_t vecSize = program.getVecSize();
+    std::int64_t slots = rotation->get<RotationAttribute>();
+    if (rotation->op == Op::RotateRightConst) slots = -slots;
+    return ((slots % vecSize) + vecSize) % vecSize;
+  }
+
+  // Computes the fewest rotations by keys needed for each step
+  void computeDistances() {
+    auto vecSize = program.getVecSize();
+    distance.assign(vecSize, std::numeric_limits<std::uint32_t>::max());
+    lastKey.assign(vecSize, 0);
+    distance[0] = 0;
+    std::deque<std::uint32_t> queue = {0};
+    while (!queue.empty()) {
+      auto step = queue.front();
+      queue.pop_front();
+      for (auto key : keys) {
+        auto next = (step + key) % vecSize;
+        if (distance[next] != std::numeric_limits<std::uint32_t>::max()) {
+          continue;
+        }
+        distance[next] = distance[step] + 1;
+        lastKey[next] = key;
+        queue.push_back(next);
+      }
+    }
+  }
+
+public:
+  RotationDecomposer(Program &g, TermMap<Type> &type,
+                     TermMapOptional<std::uint32_t> &scale,
+                     std::uint32_t maxKeys)
+      : program(g), type(type), scale(scale), maxKeys(maxKeys) {}
+
+  void count(const Term::Ptr &term) {
+    if (!isRotation(term) || type[term] == Type::Raw) return;
+    auto step = getLeftStep(term);
+    if (step != 0) ++stepCounts[step];
+  }
+
+  // Selects the keys and returns whether any rotations need to be decomposed
+  bool selectKeys() {
+    if (stepCounts.size() <= maxKeys) return false;
+    auto vecSize = program.getVecSize();
+
+    // Start from the powers of the smallest radix that fits into the budget
+    keys = getRadixRotationKeys(vecSize, maxKeys);
+    computeDistances();
+
+    // Greedily add the steps that save the most rotations. The saving is
+    // estimated by allowing the candidate key to be used once.
+    while (keys.size() < maxKeys) {
+      std::uint32_t bestKey = 0;
+      std::uint64_t bestSaving = 0;
+      for (auto &[candidate, ignored] : stepCounts) {
+        if (keys.count(candidate)) continue;
+        std::uint64_t saving = 0;
+        for (auto &[step, count] : stepCounts) {
+          auto rest = (step + vecSize - candidate) % vecSize;
+          if (distance[rest] + 1 < distance[step]) {
+            saving += count * (distance[step] - distance[rest] - 1);
+          }
+        }
+        if (saving > bestSaving) {
+          bestSaving = saving;
+          bestKey = candidate;
+        }
+      }
+      if (bestSaving == 0) break;
+      keys.insert(bestKey);
+      computeDistances();
+    }
+    return true;
+  }
+
+  const std::set<std::uint32_t> &getKeys() { return keys; }
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (!isRotation(term) || type[term] == Type::Raw) return;
+    auto step = getLeftStep(term);
+    if (step == 0) return;
+    if (term->op == Op::RotateLeftConst &&
+        static_cast<std::int64_t>(term->get<RotationAttribute>()) == step &&
+        keys.count(step)) {
+      return;
+    }
+    rotations.push_back(term);
+  }
+
+  void decompose() {
+    for (auto &term : rotations) {
+      // Right rotations are turned into left rotations, as these use the keys
+      auto step = getLeftStep(term);
+      auto result = term->operandAt(0);
+      while (step != 0) {
+        auto key = lastKey[step];
+        result = program.makeLeftRotation(result, key);
+        type[result] = type[term];
+        scale[result] = scale[term];
+        step = (step + program.getVecSize() - key) % program.getVecSize();
+      }
+      term->replaceAllUsesWith(result);
+    }
+    rotations.clear();
+  }
+};
+
+} // namespace eva
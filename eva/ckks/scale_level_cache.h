@@ -0,0 +1,106 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/program_observer.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+/*
+Caches the scale and level of each term, so that the passes that need them do
+not each compute them with a traversal of their own. Terms with an
+EncodeAtScaleAttribute or EncodeAtLevelAttribute take their scale or level from
+it. Otherwise the scale of a product is the sum of the scales of its operands,
+a Rescale term has the scale of its operand minus the divisor and other terms
+have the largest scale of their operands. The level of other terms is the
+largest level of their operands, plus one for Rescale and ModSwitch terms.
+
+Values are computed when first asked for, along with those of the terms they
+depend on. When the operands of a term change, the cached values of the term
+and of the terms that depend on it are dropped, so the cache stays valid while
+passes rewrite the program and only the rewritten parts are computed again.
+Changes to the attributes of a term are not observed, so the attributes must
+be set before the values of the term are first asked for.
+*/
+class ScaleLevelCache : public ProgramObserver {
+  TermMapOptional<std::uint32_t> scales;
+  TermMapOptional<std::uint32_t> levels;
+  std::vector<Term *> worklist;
+
+  void compute(const Term::Ptr &term) {
+    // Programs may be too deep to recurse into the operands
+    std::vector<std::pair<Term::Ptr, bool>> stack = {{term, false}};
+    while (!stack.empty()) {
+      auto [current, operandsDone] = stack.back();
+      stack.pop_back();
+      if (scales.has(current)) continue;
+      if (!operandsDone) {
+        stack.emplace_back(current, true);
+        for (auto &operand : current->getOperands()) {
+          if (!scales.has(operand)) stack.emplace_back(operand, false);
+        }
+        continue;
+      }
+
+      std::uint32_t scale = 0, level = 0;
+      for (auto &operand : current->getOperands()) {
+        if (current->op == Op::Mul) {
+          scale += scales.at(operand);
+        } else {
+          scale = std::max(scale, scales.at(operand));
+        }
+        level = std::max(level, levels.at(operand));
+      }
+      if (current->has<EncodeAtScaleAttribute>()) {
+        scale = current->get<EncodeAtScaleAttribute>();
+      } else if (current->op == Op::Rescale) {
+        scale -= current->get<RescaleDivisorAttribute>();
+      }
+      if (current->has<EncodeAtLevelAttribute>()) {
+        level = current->get<EncodeAtLevelAttribute>();
+      } else if (current->op == Op::Rescale || current->op == Op::ModSwitch) {
+        ++level;
+      }
+      scales[current] = scale;
+      levels[current] = level;
+    }
+  }
+
+public:
+  ScaleLevelCache(Program &g) : ProgramObserver(g), scales(g), levels(g) {}
+
+  std::uint32_t getScale(const Term::Ptr &term) {
+    if (!scales.has(term)) compute(term);
+    return scales.at(term);
+  }
+
+  std::uint32_t getLevel(const Term::Ptr &term) {
+    if (!levels.has(term)) compute(term);
+    return levels.at(term);
+  }
+
+  // A term is only cached once its operands are, so the uses of a term that
+  // is not cached are not either
+  void operandsChanged(Term &term) override {
+    worklist.push_back(&term);
+    while (!worklist.empty()) {
+      auto current = worklist.back();
+      worklist.pop_back();
+      if (!scales.has(*current)) continue;
+      scales.erase(*current);
+      levels.erase(*current);
+      for (auto &use : current->getUses()) {
+        worklist.push_back(use.get());
+      }
+    }
+  }
+};
+
+} // namespace eva
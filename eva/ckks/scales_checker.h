@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "eva/ckks/scale_level_cache.h"
 #include "eva/ir/program.h"
 #include "eva/ir/term_map.h"
 #include <cassert>
@@ -13,69 +14,42 @@ namespace eva {
 
 class ScalesChecker {
 public:
-  ScalesChecker(Program &g, TermMapOptional<std::uint32_t> &scales,
-                TermMap<Type> &types)
-      : program_(g), scales_(g), types_(types) {}
+  ScalesChecker(Program &g, ScaleLevelCache &scales, TermMap<Type> &types)
+      : program_(g), scales_(scales), types_(types) {}
 
   void operator()(const Term::Ptr &term) {
-    // Must only be used with forward pass traversal
+    // The scales themselves come from the cache, which computes them from the
+    // scales of the sources
     if (types_[term] == Type::Raw) {
       return;
     }
     auto &operands = term->getOperands();
+    auto scale = scales_.getScale(term);
 
-    // Nothing to do for source terms
     if (term->op == Op::Input || term->op == Op::Encode) {
-      scales_[term] = term->get<EncodeAtScaleAttribute>();
-      if (scales_.at(term) == 0) {
+      if (scale == 0) {
         if (term->op == Op::Input) {
           throw std::runtime_error("Program has an input with 0 scale");
         } else {
           throw std::logic_error("Compiled program results in a 0 scale term");
         }
       }
-    } else if (term->op == Op::Mul) {
+      return;
+    }
+    if (term->op == Op::Mul) {
       assert(term->numOperands() == 2);
-      std::uint32_t scale = 0;
-      for (auto &operand : operands) {
-        scale += scales_.at(operand);
-      }
-      if (scale == 0) {
-        throw std::logic_error("Compiled program results in a 0 scale term");
-      }
-      scales_[term] = scale;
     } else if (term->op == Op::Rescale) {
       assert(term->numOperands() == 1);
-      auto divisor = term->get<RescaleDivisorAttribute>();
-      auto operandScale = scales_.at(term->operandAt(0));
-      std::uint32_t scale = operandScale - divisor;
-      if (scale == 0) {
-        throw std::logic_error("Compiled program results in a 0 scale term");
-      }
-      scales_[term] = scale;
-
     } else if (isAdditionOp(term->op)) {
-      std::uint32_t scale = 0;
       for (auto &operand : operands) {
-        if (scale == 0) {
-          scale = scales_.at(operand);
-        } else {
-          if (scale != scales_.at(operand)) {
-            throw std::logic_error("Addition or subtraction in program has "
-                                   "operands of non-equal scale");
-          }
+        if (scales_.getScale(operand) != scale) {
+          throw std::logic_error("Addition or subtraction in program has "
+                                 "operands of non-equal scale");
         }
       }
-      if (scale == 0) {
-        throw std::logic_error("Compiled program results in a 0 scale term");
-      }
-      scales_[term] = scale;
-    } else {
-      auto scale = scales_.at(term->operandAt(0));
-      if (scale == 0) {
-        throw std::logic_error("Compiled program results in a 0 scale term");
-      }
-      scales_[term] = scale;
+    }
+    if (scale == 0) {
+      throw std::logic_error("Compiled program results in a 0 scale term");
     }
   }
 
@@ -85,7 +59,7 @@ public:
 
 private:
   Program &program_;
-  TermMapOptional<std::uint32_t> scales_;
+  ScaleLevelCache &scales_;
   TermMap<Type> &types_;
 
   bool isAdditionOp(const Op &op_code) {
@@ -0,0 +1,130 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <vector>
+
+namespace eva {
+
+/*
+Peephole simplifications of multiplications, additions and negations:
+  x * 1 -> x             x * 0 -> 0            x * -1 -> -x
+  x + 0 -> x             x - 0 -> x            0 - x -> -x
+  a + -b -> a - b        -a + b -> b - a       a - -b -> a + b
+  --x -> x
+Must run after ConstantFolder, as only one operand is expected to be a
+constant.
+*/
+class AlgebraicSimplifier {
+  Program &program;
+  TermMapOptional<std::uint32_t> &scale;
+  std::vector<double> scratch;
+
+  // Checks that term is a constant with all elements equal to value
+  bool isUniformConstant(const Term::Ptr &term, double value) {
+    if (term->op != Op::Constant) return false;
+    auto &constant = term->get<ConstantValueAttribute>();
+    if (value == 0) return constant->isZero();
+    auto &values = constant->expand(scratch, program.getVecSize());
+    return std::all_of(values.begin(), values.end(),
+                       [&](double element) { return element == value; });
+  }
+
+  void replace(const Term::Ptr &term, const Term::Ptr &replacement) {
+    term->replaceAllUsesWith(replacement);
+    assert(term->numUses() == 0);
+  }
+
+  void replaceWithZero(const Term::Ptr &term, const Term::Ptr &zero) {
+    auto constant = program.makeUniformConstant(0);
+    scale[constant] = scale[zero];
+    constant->set<EncodeAtScaleAttribute>(scale[constant]);
+    replace(term, constant);
+  }
+
+  void simplifyMul(const Term::Ptr &term) {
+    for (int i = 0; i < 2; ++i) {
+      auto constant = term->operandAt(i);
+      auto other = term->operandAt(1 - i);
+      if (isUniformConstant(constant, 0)) {
+        replaceWithZero(term, constant);
+        return;
+      }
+      if (isUniformConstant(constant, 1)) {
+        replace(term, other);
+        return;
+      }
+      if (isUniformConstant(constant, -1)) {
+        replace(term, program.makeTerm(Op::Negate, {other}));
+        return;
+      }
+    }
+  }
+
+  void simplifyAdd(const Term::Ptr &term) {
+    auto left = term->operandAt(0);
+    auto right = term->operandAt(1);
+    if (isUniformConstant(right, 0)) {
+      replace(term, left);
+    } else if (isUniformConstant(left, 0)) {
+      replace(term, right);
+    } else if (right->op == Op::Negate) {
+      replace(term, program.makeTerm(Op::Sub, {left, right->operandAt(0)}));
+    } else if (left->op == Op::Negate) {
+      replace(term, program.makeTerm(Op::Sub, {right, left->operandAt(0)}));
+    }
+  }
+
+  void simplifySub(const Term::Ptr &term) {
+    auto left = term->operandAt(0);
+    auto right = term->operandAt(1);
+    if (isUniformConstant(right, 0)) {
+      replace(term, left);
+    } else if (isUniformConstant(left, 0)) {
+      replace(term, program.makeTerm(Op::Negate, {right}));
+    } else if (right->op == Op::Negate) {
+      replace(term, program.makeTerm(Op::Add, {left, right->operandAt(0)}));
+    }
+  }
+
+  void simplifyNegate(const Term::Ptr &term) {
+    auto operand = term->operandAt(0);
+    if (operand->op == Op::Negate) {
+      replace(term, operand->operandAt(0));
+    }
+  }
+
+public:
+  AlgebraicSimplifier(Program &g, TermMapOptional<std::uint32_t> &scale)
+      : program(g), scale(scale) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    switch (term->op) {
+    case Op::Mul:
+      assert(term->numOperands() == 2);
+      simplifyMul(term);
+      break;
+    case Op::Add:
+      assert(term->numOperands() == 2);
+      simplifyAdd(term);
+      break;
+    case Op::Sub:
+      assert(term->numOperands() == 2);
+      simplifySub(term);
+      break;
+    case Op::Negate:
+      assert(term->numOperands() == 1);
+      simplifyNegate(term);
+      break;
+    default:
+      break;
+    }
+  }
+};
+
+} // namespace eva
@@ -0,0 +1,79 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/common/program_hasher.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include "eva/util/hash.h"
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace eva {
+
+/*
+Global value numbering pass that merges structurally identical terms. Terms
+are numbered by a hash of their op, attributes and (already numbered)
+operands, so identical subexpressions end up with the same representative term
+and all uses are redirected to it. Operands of commutative ops are compared as
+multisets and constants are compared by value, which also merges constants that
+were written separately in the source program.
+*/
+class CommonSubexpressionEliminator {
+  Program &program;
+  std::unordered_map<std::uint64_t, std::vector<Term::Ptr>> representatives;
+
+  bool isCommutativeOp(const Op &op_code) {
+    return ((op_code == Op::Add) || (op_code == Op::Mul));
+  }
+
+  std::vector<Term *> getCanonicalOperands(const Term::Ptr &term) {
+    std::vector<Term *> operands;
+    for (auto &operand : term->getOperands()) {
+      operands.push_back(operand.get());
+    }
+    if (isCommutativeOp(term->op)) {
+      std::sort(operands.begin(), operands.end(),
+                [](Term *a, Term *b) { return a->index < b->index; });
+    }
+    return operands;
+  }
+
+  bool isEquivalent(const Term::Ptr &a, const Term::Ptr &b) {
+    return a->op == b->op &&
+           getCanonicalOperands(a) == getCanonicalOperands(b) &&
+           equalAttributes(*a, *b, program.getVecSize());
+  }
+
+public:
+  CommonSubexpressionEliminator(Program &g) : program(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    // Inputs and outputs are identified by their names and are never merged
+    if (term->op == Op::Input || term->op == Op::Output) return;
+
+    // All operands have already been replaced with their representatives, so
+    // hashing operand indices numbers the whole subexpression
+    Hasher hasher;
+    hasher.update(term->op);
+    for (auto &operand : getCanonicalOperands(term)) {
+      hasher.update(operand->index);
+    }
+    hashAttributes(hasher, *term, program.getVecSize());
+
+    auto &candidates = representatives[hasher.digest()];
+    for (auto &candidate : candidates) {
+      if (isEquivalent(candidate, term)) {
+        term->replaceAllUsesWith(candidate);
+        return;
+      }
+    }
+    candidates.push_back(term);
+  }
+};
+
+} // namespace eva
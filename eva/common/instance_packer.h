@@ -0,0 +1,154 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+/*
+Makes a program correct when the slots of a ciphertext hold several independent
+instances of its inputs, one in each block of vecSize slots, instead of
+replicas of a single instance. Elementwise operations and replicated constants
+already work on each block separately, but rotations move elements across
+blocks. A left rotation by k within each block is rewritten into rotations of
+the whole ciphertext as
+
+  ((x << k) * low) + ((x >> (vecSize - k)) * high)
+
+where low masks the first vecSize - k slots of each block and high the rest.
+Reduce terms summing whole cosets, such as horizontal sums, are lowered without
+masking each rotation: a rotate-and-add doubling over the whole ciphertext sums
+up the correct elements in the first stride slots of each block, which are then
+masked once and replicated back within the block. Other Reduce terms must have
+been lowered by ReduceLowering already.
+
+The rotations made by this pass are exact rotations of the ciphertext, so the
+passes that normalize rotations modulo vecSize must not run after it. The
+rewritten program computes the same values as before when evaluated on a single
+instance. Use with a forward pass to find the terms to rewrite, and then call
+pack. The rewrite is deferred because the traversal does not reach the uses of
+a term once they are rewired to a replacement made of several new terms.
+*/
+class InstancePacker {
+  Program &program;
+  TermMapOptional<std::uint32_t> &scale;
+  std::uint32_t maskScale = 0;
+  std::map<std::pair<Term *, std::int64_t>, Term::Ptr> slotRotations;
+  std::vector<Term::Ptr> pending;
+  std::map<std::pair<std::uint32_t, std::uint32_t>, Term::Ptr> masks;
+
+  bool isRotation(const Term::Ptr &term) {
+    return term->op == Op::RotateLeftConst || term->op == Op::RotateRightConst;
+  }
+
+  // Rotates the whole ciphertext left by slots, or right if slots is negative
+  Term::Ptr rotateSlots(const Term::Ptr &term, std::int64_t slots) {
+    auto &rotation = slotRotations[{term.get(), slots}];
+    if (!rotation) {
+      rotation = slots > 0 ? program.makeLeftRotation(term, slots)
+                           : program.makeRightRotation(term, -slots);
+    }
+    return rotation;
+  }
+
+  // Returns a mask selecting the slots in [begin, end) of each block
+  Term::Ptr getMask(std::uint32_t begin, std::uint32_t end) {
+    auto &mask = masks[{begin, end}];
+    if (!mask) {
+      std::vector<double> values(program.getVecSize(), 0);
+      std::fill(values.begin() + begin, values.begin() + end, 1);
+      mask = program.makeDenseConstant(values);
+      scale[mask] = maskScale;
+      mask->set<EncodeAtScaleAttribute>(maskScale);
+    }
+    return mask;
+  }
+
+  Term::Ptr rotateWithinBlocks(const Term::Ptr &term, std::uint32_t left) {
+    std::uint32_t vecSize = program.getVecSize();
+    auto low = program.makeTerm(
+        Op::Mul, {rotateSlots(term, left), getMask(0, vecSize - left)});
+    auto high = program.makeTerm(
+        Op::Mul, {rotateSlots(term, -std::int64_t(vecSize - left)),
+                  getMask(vecSize - left, vecSize)});
+    return program.makeTerm(Op::Add, {low, high});
+  }
+
+  Term::Ptr lowerCosetReduction(const Term::Ptr &term, std::uint32_t stride) {
+    std::uint32_t vecSize = program.getVecSize();
+    auto window = term;
+    for (std::uint32_t step = stride; step < vecSize; step *= 2) {
+      window = program.makeTerm(Op::Add, {window, rotateSlots(window, step)});
+    }
+    auto sum = program.makeTerm(Op::Mul, {window, getMask(0, stride)});
+    for (std::uint32_t step = stride; step < vecSize; step *= 2) {
+      sum = program.makeTerm(Op::Add,
+                             {sum, rotateSlots(sum, -std::int64_t(step))});
+    }
+    return sum;
+  }
+
+  void rewrite(const Term::Ptr &term) {
+    if (term->op == Op::Reduce) {
+      std::uint64_t stride = term->get<ReduceStrideAttribute>();
+      std::uint32_t count = term->get<ReduceCountAttribute>();
+      if (stride * count != program.getVecSize()) {
+        throw std::logic_error("Reduce terms not summing whole cosets must be "
+                               "lowered before InstancePacker");
+      }
+      if (count == 1) {
+        term->replaceAllUsesWith(term->operandAt(0));
+      } else {
+        term->replaceAllUsesWith(
+            lowerCosetReduction(term->operandAt(0), stride));
+      }
+      return;
+    }
+
+    std::int64_t vecSize = program.getVecSize();
+    std::int64_t slots = term->get<RotationAttribute>();
+    if (term->op == Op::RotateRightConst) slots = -slots;
+    slots = ((slots % vecSize) + vecSize) % vecSize;
+    if (slots == 0) {
+      term->replaceAllUsesWith(term->operandAt(0));
+    } else {
+      term->replaceAllUsesWith(rotateWithinBlocks(term->operandAt(0), slots));
+    }
+  }
+
+public:
+  InstancePacker(Program &g, TermMapOptional<std::uint32_t> &scale)
+      : program(g), scale(scale) {
+    // Encode masks at the largest scale of any input or constant
+    for (auto &source : g.getSources()) {
+      if (scale.has(source)) {
+        maskScale = std::max(maskScale, scale[source]);
+      }
+    }
+  }
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (term->op == Op::Reduce || isRotation(term)) {
+      pending.push_back(term);
+    }
+  }
+
+  void pack() {
+    for (auto &term : pending) {
+      rewrite(term);
+    }
+    pending.clear();
+  }
+};
+
+} // namespace eva
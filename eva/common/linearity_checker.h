@@ -0,0 +1,70 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+
+namespace eva {
+
+/*
+Checks whether every output of a program is a linear function of its inputs
+with real coefficients, i.e., built from the inputs with additions,
+subtractions, negations, rotations, reductions and multiplications by terms
+that do not depend on any input. For such programs f(x + iy) = f(x) + if(y),
+so two real instances can be processed at once in the real and imaginary parts
+of the slots. Adding a constant to a term that depends on the inputs, or
+multiplying two such terms, makes the program non-linear, as do inputs of raw
+type, which are shared by all instances. Use with a forward pass, and then
+query isLinear.
+*/
+class LinearityChecker {
+  Program &program;
+  // Whether each term depends on any input
+  TermMap<bool> dependent;
+  bool linear = true;
+
+public:
+  LinearityChecker(Program &g) : program(g), dependent(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    std::size_t dependentOperands = 0;
+    for (auto &operand : term->getOperands()) {
+      if (dependent[operand]) ++dependentOperands;
+    }
+    dependent[term] = dependentOperands > 0;
+
+    switch (term->op) {
+    case Op::Input:
+      dependent[term] = true;
+      if (term->get<TypeAttribute>() == Type::Raw) linear = false;
+      break;
+    case Op::Constant:
+    case Op::Output:
+    case Op::Negate:
+    case Op::RotateLeftConst:
+    case Op::RotateRightConst:
+    case Op::Reduce:
+      break;
+    case Op::Add:
+    case Op::Sub:
+      // Mixing in a constant makes the result affine
+      if (dependentOperands != 0 &&
+          dependentOperands != term->numOperands()) {
+        linear = false;
+      }
+      break;
+    case Op::Mul:
+      if (dependentOperands > 1) linear = false;
+      break;
+    default:
+      linear = false;
+    }
+  }
+
+  bool isLinear() { return linear; }
+};
+
+} // namespace eva
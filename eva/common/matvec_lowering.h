@@ -0,0 +1,111 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace eva {
+
+/*
+Lowers MatVec terms with the diagonal method of Halevi and Shoup using
+baby-step giant-step rotations. A MatVec term has the operands x, d_0, ...,
+d_(n-1), where d_i is the i-th generalized diagonal of the matrix, and computes
+the sum of d_i * (x << i). Splitting i = j * n1 + k gives
+
+  sum_j ((sum_k (d_(j*n1+k) >> j*n1) * (x << k)) << j*n1)
+
+where the n1 baby step rotations of x are shared between all giant steps and
+the rotations of the diagonals are done at compile time by ConstantFolder. For
+n1 around sqrt(n) this needs O(sqrt(n)) instead of n rotations of x. Zero
+diagonals are skipped. Use with a forward pass to gather the MatVec terms and
+then call lower. The rewrite is deferred like in ReduceLowering, as the
+traversal does not reach a MatVec term whose operand was replaced by the
+lowering of another one. Must run before ConstantFolder, as the other passes do
+not handle MatVec terms.
+*/
+class MatVecLowering {
+  Program &program;
+  std::vector<Term::Ptr> matVecs;
+
+  bool isZero(const Term::Ptr &diagonal) {
+    return diagonal->op == Op::Constant &&
+           diagonal->get<ConstantValueAttribute>()->isZero();
+  }
+
+  Term::Ptr add(const Term::Ptr &left, const Term::Ptr &right) {
+    if (!left) return right;
+    return program.makeTerm(Op::Add, {left, right});
+  }
+
+  void lowerMatVec(const Term::Ptr &term) {
+    if (term->numOperands() < 2 ||
+        term->numOperands() - 1 > program.getVecSize()) {
+      throw std::runtime_error("MatVec terms must have between one and "
+                               "vector size many diagonals");
+    }
+
+    auto x = term->operandAt(0);
+    auto &operands = term->getOperands();
+    std::vector<Term::Ptr> diagonals(operands.begin() + 1, operands.end());
+    std::uint32_t n = diagonals.size();
+
+    // Use the smallest power of two at least sqrt(n) baby steps
+    std::uint32_t babySteps = 1;
+    while (babySteps * babySteps < n) {
+      babySteps *= 2;
+    }
+
+    std::vector<Term::Ptr> rotations(babySteps);
+    rotations[0] = x;
+    Term::Ptr result;
+    for (std::uint32_t giant = 0; giant < n; giant += babySteps) {
+      Term::Ptr inner;
+      for (std::uint32_t baby = 0; baby < babySteps && giant + baby < n;
+           ++baby) {
+        auto &diagonal = diagonals[giant + baby];
+        if (isZero(diagonal)) continue;
+        if (!rotations[baby]) {
+          rotations[baby] = program.makeLeftRotation(x, baby);
+        }
+        auto rotatedDiagonal =
+            giant == 0 ? diagonal : program.makeRightRotation(diagonal, giant);
+        inner = add(inner, program.makeTerm(Op::Mul, {rotatedDiagonal,
+                                                      rotations[baby]}));
+      }
+      if (!inner) continue;
+      if (giant != 0) {
+        inner = program.makeLeftRotation(inner, giant);
+      }
+      result = add(result, inner);
+    }
+
+    // All diagonals are zero, so the zero constant d_0 is the result
+    if (!result) result = diagonals[0];
+    term->replaceAllUsesWith(result);
+  }
+
+public:
+  MatVecLowering(Program &g) : program(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (term->op == Op::MatVec) {
+      matVecs.push_back(term);
+    }
+  }
+
+  // Lowers the gathered MatVec terms in traversal order, so the operands of
+  // each are already lowered
+  void lower() {
+    for (auto &term : matVecs) {
+      lowerMatVec(term);
+    }
+    matVecs.clear();
+  }
+};
+
+} // namespace eva
@@ -0,0 +1,145 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+namespace eva {
+
+/*
+Lowers Polynomial terms into multiplications and additions with baby-step
+giant-step (Paterson-Stockmeyer) evaluation. A Polynomial term has the operands
+x, c_0, c_1, ..., c_d and computes c_0 + c_1 * x + ... + c_d * x^d elementwise.
+
+The baby steps x, x^2, ..., x^k for a power-of-two k around sqrt(d) are
+computed directly and the giant steps x^k, x^2k, x^4k, ... by squaring. The
+polynomial is then split recursively as p(x) = q(x) * x^g + r(x) at the
+largest giant step g below its degree, until the parts are small enough to be
+evaluated as linear combinations of the baby steps. This needs about
+sqrt(2d) + log(d) ciphertext multiplications with a multiplicative depth of
+log(d) plus one for the coefficients. Use with a forward pass to gather the
+Polynomial terms and then call lower. The rewrite is deferred like in
+ReduceLowering, as the traversal does not reach a Polynomial term whose operand
+was replaced by the lowering of another one. Must run before ConstantFolder, as
+the other passes do not handle Polynomial terms.
+*/
+class PolynomialLowering {
+  Program &program;
+  std::vector<Term::Ptr> polynomials;
+  Term::Ptr x;
+  std::vector<Term::Ptr> coefficients;
+  std::unordered_map<std::uint64_t, Term::Ptr> powers;
+  std::uint64_t babySteps;
+
+  // Computes x^exponent with the minimal depth of ceil(log2(exponent))
+  Term::Ptr getPower(std::uint64_t exponent) {
+    auto &power = powers[exponent];
+    if (!power) {
+      std::uint64_t half = 1;
+      while (2 * half < exponent) {
+        half *= 2;
+      }
+      auto result = program.makeTerm(
+          Op::Mul, {getPower(half), getPower(exponent - half)});
+      // getPower may have rehashed powers, so look the entry up again
+      powers[exponent] = result;
+      return result;
+    }
+    return power;
+  }
+
+  bool isZero(const Term::Ptr &coefficient) {
+    return coefficient->op == Op::Constant &&
+           coefficient->get<ConstantValueAttribute>()->isZero();
+  }
+
+  Term::Ptr add(const Term::Ptr &left, const Term::Ptr &right) {
+    if (!left) return right;
+    if (!right) return left;
+    return program.makeTerm(Op::Add, {left, right});
+  }
+
+  // Evaluates the polynomial with coefficients [begin, end) shifted down to
+  // start at degree zero. Returns null if all coefficients are zero.
+  Term::Ptr evaluate(std::uint64_t begin, std::uint64_t end) {
+    if (end - begin <= babySteps) {
+      Term::Ptr result;
+      for (auto i = begin + 1; i < end; ++i) {
+        if (isZero(coefficients[i])) continue;
+        result = add(result, program.makeTerm(Op::Mul, {coefficients[i],
+                                                        getPower(i - begin)}));
+      }
+      if (!isZero(coefficients[begin])) {
+        result = add(result, coefficients[begin]);
+      }
+      return result;
+    }
+
+    auto giantStep = babySteps;
+    while (2 * giantStep < end - begin) {
+      giantStep *= 2;
+    }
+    auto low = evaluate(begin, begin + giantStep);
+    auto high = evaluate(begin + giantStep, end);
+    if (high) {
+      high = program.makeTerm(Op::Mul, {high, getPower(giantStep)});
+    }
+    return add(high, low);
+  }
+
+  void lowerPolynomial(const Term::Ptr &term) {
+    if (term->numOperands() < 2) {
+      throw std::runtime_error(
+          "Polynomial terms must have at least one coefficient");
+    }
+
+    x = term->operandAt(0);
+    auto &operands = term->getOperands();
+    coefficients.assign(operands.begin() + 1, operands.end());
+    powers.clear();
+    powers[1] = x;
+
+    // Use about sqrt(degree) baby steps rounded to a power of two
+    std::uint64_t degree = coefficients.size() - 1;
+    std::uint32_t logDegree = 0;
+    while ((1ull << logDegree) <= degree) {
+      ++logDegree;
+    }
+    babySteps = 1ull << ((logDegree + 1) / 2);
+
+    auto result = evaluate(0, coefficients.size());
+    // All coefficients are zero, so the zero constant term c_0 is the result
+    if (!result) result = coefficients[0];
+    term->replaceAllUsesWith(result);
+
+    x.reset();
+    coefficients.clear();
+    powers.clear();
+  }
+
+public:
+  PolynomialLowering(Program &g) : program(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (term->op == Op::Polynomial) {
+      polynomials.push_back(term);
+    }
+  }
+
+  // Lowers the gathered Polynomial terms in traversal order, so the operands
+  // of each are already lowered
+  void lower() {
+    for (auto &term : polynomials) {
+      lowerPolynomial(term);
+    }
+    polynomials.clear();
+  }
+};
+
+} // namespace eva
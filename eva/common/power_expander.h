@@ -0,0 +1,137 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+/*
+Rewrites repeated factors of flattened multiplications into square-and-multiply
+form. A ciphertext x occurring k times among the operands of a multiplication
+is replaced by the powers x^(2^i) for the bits i set in k, which are computed by
+repeated squaring and shared between all multiplications in the program. For
+example, x * x * x * x * x * x * x * y becomes x * x^2 * x^4 * y, which needs 4
+instead of 7 multiplications.
+
+As the squares are deeper than the other factors, the factors of rewritten
+multiplications are multiplied together shallowest first, which keeps the
+multiplicative depth at that of a balanced tree. Must run after
+ReductionCombiner, so that the multiplications are flattened, and before
+ReductionLogExpander, which balances the multiplications left untouched here.
+*/
+class PowerExpander {
+  Program &program;
+  TermMap<Type> &type;
+  TermMap<std::uint32_t> depth;
+  TermMap<std::vector<Term::Ptr>> squares;
+
+  Term::Ptr makeMul(const Term::Ptr &left, const Term::Ptr &right) {
+    auto mul = program.makeTerm(Op::Mul, {left, right});
+    type[mul] = (type[left] == Type::Cipher || type[right] == Type::Cipher)
+                    ? Type::Cipher
+                    : Type::Raw;
+    depth[mul] = std::max(depth[left], depth[right]) + 1;
+    return mul;
+  }
+
+  // Returns x^(2^log2), reusing squares computed earlier
+  Term::Ptr getPowerOfTwo(const Term::Ptr &base, std::uint32_t log2) {
+    if (log2 == 0) return base;
+    auto &powers = squares[base];
+    while (powers.size() < log2) {
+      auto last = powers.empty() ? base : powers.back();
+      powers.push_back(makeMul(last, last));
+    }
+    return powers[log2 - 1];
+  }
+
+  // Multiplies factors pairwise, always combining the two shallowest ones,
+  // until only two are left
+  std::vector<Term::Ptr>
+  combineShallowestFirst(const std::vector<Term::Ptr> &factors) {
+    // Order of appearance breaks ties to keep the result deterministic
+    using Entry = std::tuple<std::uint32_t, std::size_t, Term::Ptr>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    std::size_t order = 0;
+    for (auto &factor : factors) {
+      queue.emplace(depth[factor], order++, factor);
+    }
+    while (queue.size() > 2) {
+      auto left = std::get<2>(queue.top());
+      queue.pop();
+      auto right = std::get<2>(queue.top());
+      queue.pop();
+      auto mul = makeMul(left, right);
+      queue.emplace(depth[mul], order++, mul);
+    }
+    std::vector<Term::Ptr> result;
+    while (!queue.empty()) {
+      result.push_back(std::get<2>(queue.top()));
+      queue.pop();
+    }
+    return result;
+  }
+
+public:
+  PowerExpander(Program &g, TermMap<Type> &type)
+      : program(g), type(type), depth(g), squares(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    for (auto &operand : term->getOperands()) {
+      depth[term] = std::max(depth[term], depth[operand]);
+    }
+    if (term->op == Op::Mul) ++depth[term];
+
+    if (term->op != Op::Mul || term->numOperands() <= 2) return;
+
+    // Count the occurrences of each operand in order of first occurrence
+    std::vector<std::pair<Term::Ptr, std::uint32_t>> factors;
+    std::unordered_map<Term *, std::size_t> factorIndices;
+    for (auto &operand : term->getOperands()) {
+      auto [entry, inserted] =
+          factorIndices.emplace(operand.get(), factors.size());
+      if (inserted) {
+        factors.emplace_back(operand, 0);
+      }
+      ++factors[entry->second].second;
+    }
+    if (factors.size() == term->numOperands()) return;
+
+    std::vector<Term::Ptr> operands;
+    bool changed = false;
+    for (auto &[base, count] : factors) {
+      if (count == 1 || type[base] != Type::Cipher) {
+        operands.insert(operands.end(), count, base);
+        continue;
+      }
+      for (std::uint32_t log2 = 0; (count >> log2) != 0; ++log2) {
+        if ((count >> log2) & 1) {
+          operands.push_back(getPowerOfTwo(base, log2));
+        }
+      }
+      changed = true;
+    }
+    if (!changed) return;
+
+    if (operands.size() == 1) {
+      // The whole multiplication is a single power of two
+      term->replaceAllUsesWith(operands[0]);
+    } else {
+      term->setOperands(combineShallowestFirst(operands));
+    }
+  }
+};
+
+} // namespace eva
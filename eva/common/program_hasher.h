@@ -0,0 +1,142 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/attributes.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include "eva/util/hash.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+namespace detail {
+inline void hashAttributeValue(Hasher &hasher, std::uint64_t vecSize,
+                               const std::uint32_t &value) {
+  hasher.update(value);
+}
+
+inline void hashAttributeValue(Hasher &hasher, std::uint64_t vecSize,
+                               const std::int32_t &value) {
+  hasher.update(value);
+}
+
+inline void hashAttributeValue(Hasher &hasher, std::uint64_t vecSize,
+                               const Type &value) {
+  hasher.update(value);
+}
+
+inline void hashAttributeValue(Hasher &hasher, std::uint64_t vecSize,
+                               const std::shared_ptr<ConstantValue> &value) {
+  // Hash the expanded values so that equal constants hash the same regardless
+  // of their representation
+  std::vector<double> scratch;
+  auto &values = value->expand(scratch, vecSize);
+  hasher.update(values.data(), values.size() * sizeof(double));
+}
+
+template <class T>
+bool equalAttributeValues(std::uint64_t vecSize, const T &a, const T &b) {
+  return a == b;
+}
+
+inline bool equalAttributeValues(std::uint64_t vecSize,
+                                 const std::shared_ptr<ConstantValue> &a,
+                                 const std::shared_ptr<ConstantValue> &b) {
+  if (a == b) return true;
+  std::vector<double> scratchA, scratchB;
+  return a->expand(scratchA, vecSize) == b->expand(scratchB, vecSize);
+}
+} // namespace detail
+
+// Hashes all attributes set on a term into hasher
+inline void hashAttributes(Hasher &hasher, const Term &term,
+                           std::uint64_t vecSize) {
+#define X(name, type)                                                          \
+  if (term.has<name>()) {                                                      \
+    hasher.update(name::key);                                                  \
+    detail::hashAttributeValue(hasher, vecSize, term.get<name>());             \
+  }
+  EVA_ATTRIBUTES
+#undef X
+}
+
+// Checks that two terms have the same attributes with equal values
+inline bool equalAttributes(const Term &a, const Term &b,
+                            std::uint64_t vecSize) {
+#define X(name, type)                                                          \
+  if (a.has<name>() != b.has<name>()) return false;                            \
+  if (a.has<name>() && !detail::equalAttributeValues(vecSize, a.get<name>(),   \
+                                                     b.get<name>()))           \
+    return false;
+  EVA_ATTRIBUTES
+#undef X
+  return true;
+}
+
+/*
+Computes a structural hash of a Program that covers the operations, the
+constants, all attributes (e.g., scales and ranges) and the names of inputs and
+outputs. The hash of each input term includes its name, so programs that only
+differ in which inputs are used where hash differently. Programs that compile
+to different results may still collide, so users of the hash must compare the
+programs themselves before relying on a match. Must be used with a forward
+traversal.
+*/
+class ProgramHasher {
+  Program &program;
+  TermMap<std::uint64_t> hashes;
+  TermMapOptional<std::string> inputNames;
+
+public:
+  ProgramHasher(Program &g) : program(g), hashes(g), inputNames(g) {
+    for (auto &entry : program.getInputs()) {
+      inputNames[entry.second] = entry.first;
+    }
+  }
+
+  void operator()(const Term::Ptr &term) {
+    Hasher hasher;
+    hasher.update(term->op);
+    if (inputNames.has(term)) {
+      hasher.update(inputNames.at(term));
+    }
+    hasher.update(term->numOperands());
+    for (auto &operand : term->getOperands()) {
+      hasher.update(hashes[operand]);
+    }
+    hashAttributes(hasher, *term, program.getVecSize());
+    hashes[term] = hasher.digest();
+  }
+
+  std::uint64_t getHash() {
+    Hasher hasher;
+    hasher.update(program.getName());
+    hasher.update(program.getVecSize());
+
+    // The input and output maps are unordered, so sort them by name first
+    auto hashNamed = [&](const auto &terms) {
+      std::vector<std::pair<std::string, std::uint64_t>> named;
+      for (auto &entry : terms) {
+        named.emplace_back(entry.first, hashes[entry.second]);
+      }
+      std::sort(named.begin(), named.end());
+      hasher.update(named.size());
+      for (auto &entry : named) {
+        hasher.update(entry.first);
+        hasher.update(entry.second);
+      }
+    };
+    hashNamed(program.getInputs());
+    hashNamed(program.getOutputs());
+    // Terms that no output depends on are not compiled, so they are left out
+    return hasher.digest();
+  }
+};
+
+} // namespace eva
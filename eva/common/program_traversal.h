@@ -4,8 +4,10 @@
 #pragma once
 
 #include "eva/ir/program.h"
+#include "eva/ir/program_observer.h"
 #include "eva/ir/term_map.h"
 #include "eva/util/logging.h"
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 
@@ -17,8 +19,9 @@ presence of modifications during traversal.
 The rewriter is called for each term in the Program exactly once.
 Rewriters must not modify the Program in such a way that terms that are
 not uses/operands (for forward/backward traversal, respectively) of the
-current term are enabled. With such modifications the whole program is
-not guaranteed to be traversed.
+current term are enabled. Replacing the current term with new terms is
+allowed. With other modifications the whole program is not guaranteed to be
+traversed.
 */
 class ProgramTraversal {
   Program &program;
@@ -26,6 +29,31 @@ class ProgramTraversal {
   TermMap<bool> ready;
   TermMap<bool> processed;
 
+  // Records the terms that become sources/sinks during a rewrite, so that
+  // they can be made ready without going through all sources/sinks
+  class LeafLog : public ProgramObserver {
+    bool isForward;
+
+  public:
+    std::vector<Term *> leaves;
+
+    LeafLog(Program &g, bool isForward)
+        : ProgramObserver(g), isForward(isForward) {}
+
+    void sourceAdded(Term &term) override {
+      if (isForward) leaves.push_back(&term);
+    }
+
+    void sinkAdded(Term &term) override {
+      if (!isForward) leaves.push_back(&term);
+    }
+
+    void termDestroyed(Term &term) override {
+      leaves.erase(std::remove(leaves.begin(), leaves.end(), &term),
+                   leaves.end());
+    }
+  };
+
   template <bool isForward> bool arePredecessorsDone(const Term::Ptr &term) {
     for (auto &operand : isForward ? term->getOperands() : term->getUses()) {
       if (!processed[operand]) return false;
@@ -47,6 +75,7 @@ class ProgramTraversal {
     // vector here is fine because duplicates in the list are handled
     // gracefully.
     std::vector<Term::Ptr> checkList;
+    LeafLog leafLog(program, isForward);
 
     while (readyNodes.size() != 0) {
       // Pop term to transform
@@ -61,14 +90,18 @@ class ProgramTraversal {
       }
 
       log(Verbosity::Trace, "Processing term with index=%lu", term->index);
+      leafLog.leaves.clear();
       rewrite(term);
       processed[term] = true;
 
-      // If transform adds new sources/sinks add them to ready terms.
-      for (auto &leaf : isForward ? program.getSources() : program.getSinks()) {
-        if (!ready[leaf]) {
-          readyNodes.push_back(leaf);
-          ready[leaf] = true;
+      // If transform adds new sources/sinks add them to ready terms. Terms
+      // that were leaves only while they were being made are skipped.
+      for (auto leaf : leafLog.leaves) {
+        bool isLeaf = isForward ? leaf->numOperands() == 0
+                                : leaf->numUses() == 0;
+        if (isLeaf && !ready[*leaf]) {
+          readyNodes.push_back(leaf->shared_from_this());
+          ready[*leaf] = true;
         }
       }
 
@@ -79,9 +112,20 @@ class ProgramTraversal {
 
       // Push and mark uses/operands that are ready to be processed.
       for (auto &succ : checkList) {
-        if (!ready[succ] && arePredecessorsDone<isForward>(succ)) {
+        if (ready[succ]) continue;
+        if (arePredecessorsDone<isForward>(succ)) {
           readyNodes.push_back(succ);
           ready[succ] = true;
+        } else {
+          // The rewrite may have replaced the current term with new terms,
+          // which are then neither sources/sinks nor uses/operands of the
+          // current term. Push those that are ready too.
+          for (auto &pred : isForward ? succ->getOperands() : succ->getUses()) {
+            if (!ready[pred] && arePredecessorsDone<isForward>(pred)) {
+              readyNodes.push_back(pred);
+              ready[pred] = true;
+            }
+          }
         }
       }
     }
@@ -0,0 +1,180 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+// The bounds of all elements of a vector
+struct Interval {
+  double lo = 0;
+  double hi = 0;
+
+  double maxAbs() const { return std::max(std::abs(lo), std::abs(hi)); }
+
+  Interval operator+(const Interval &other) const {
+    return {lo + other.lo, hi + other.hi};
+  }
+
+  Interval operator-(const Interval &other) const {
+    return {lo - other.hi, hi - other.lo};
+  }
+
+  Interval operator-() const { return {-hi, -lo}; }
+
+  Interval operator*(const Interval &other) const {
+    double products[] = {lo * other.lo, lo * other.hi, hi * other.lo,
+                         hi * other.hi};
+    return {*std::min_element(std::begin(products), std::end(products)),
+            *std::max_element(std::begin(products), std::end(products))};
+  }
+
+  Interval operator*(double factor) const {
+    return factor < 0 ? Interval{hi * factor, lo * factor}
+                      : Interval{lo * factor, hi * factor};
+  }
+};
+
+/*
+Computes bounds on the values of every term from bounds on the values of the
+inputs with interval arithmetic. Every element of a vector shares the same
+bounds, which for constants are the smallest and largest element. Squares of a
+term are known to be non-negative, but otherwise the bounds do not account for
+correlations between operands and may overestimate. Use with a forward pass,
+and then query getInterval or getRangeBits, which gives the bits needed for the
+RangeAttribute of an output.
+*/
+class RangeAnalyzer {
+  Program &program;
+  const std::unordered_map<std::string, std::pair<double, double>> &bounds;
+  TermMap<Interval> intervals;
+  std::unordered_map<Term *, std::string> inputNames;
+  std::vector<double> scratch;
+
+  Interval getConstantInterval(const Term::Ptr &term) {
+    auto &values = term->get<ConstantValueAttribute>()->expand(
+        scratch, program.getVecSize());
+    auto [lo, hi] = std::minmax_element(values.begin(), values.end());
+    return {*lo, *hi};
+  }
+
+  Interval getInputInterval(const Term::Ptr &term) {
+    auto &name = inputNames.at(term.get());
+    auto entry = bounds.find(name);
+    if (entry == bounds.end()) {
+      throw std::runtime_error("No bounds were given for input " + name);
+    }
+    auto [lo, hi] = entry->second;
+    if (lo > hi) {
+      throw std::runtime_error("The lower bound for input " + name +
+                               " is larger than the upper bound");
+    }
+    return {lo, hi};
+  }
+
+  Interval getPolynomialInterval(const Term::Ptr &term) {
+    // Horner's method as in ReferenceExecutor
+    auto &operands = term->getOperands();
+    auto &x = intervals[operands[0]];
+    auto result = intervals[operands.back()];
+    for (std::size_t i = operands.size() - 2; i > 0; --i) {
+      result = result * x + intervals[operands[i]];
+    }
+    return result;
+  }
+
+  Interval getMatVecInterval(const Term::Ptr &term) {
+    auto &operands = term->getOperands();
+    Interval result;
+    for (std::size_t i = 1; i < operands.size(); ++i) {
+      result = result + intervals[operands[i]] * intervals[operands[0]];
+    }
+    return result;
+  }
+
+public:
+  RangeAnalyzer(
+      Program &g,
+      const std::unordered_map<std::string, std::pair<double, double>> &bounds)
+      : program(g), bounds(bounds), intervals(g) {
+    for (auto &entry : g.getInputs()) {
+      inputNames.emplace(entry.second.get(), entry.first);
+    }
+  }
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    auto &result = intervals[term];
+    switch (term->op) {
+    case Op::Input:
+      result = getInputInterval(term);
+      break;
+    case Op::Constant:
+      result = getConstantInterval(term);
+      break;
+    case Op::Add:
+      result = intervals[term->operandAt(0)] + intervals[term->operandAt(1)];
+      break;
+    case Op::Sub:
+      result = intervals[term->operandAt(0)] - intervals[term->operandAt(1)];
+      break;
+    case Op::Mul:
+      if (term->operandAt(0) == term->operandAt(1)) {
+        auto &x = intervals[term->operandAt(0)];
+        double lo = x.lo <= 0 && x.hi >= 0 ? 0
+                                           : std::min(x.lo * x.lo, x.hi * x.hi);
+        result = {lo, x.maxAbs() * x.maxAbs()};
+      } else {
+        result = intervals[term->operandAt(0)] * intervals[term->operandAt(1)];
+      }
+      break;
+    case Op::Negate:
+      result = -intervals[term->operandAt(0)];
+      break;
+    case Op::Reduce:
+      result =
+          intervals[term->operandAt(0)] * term->get<ReduceCountAttribute>();
+      break;
+    case Op::Polynomial:
+      result = getPolynomialInterval(term);
+      break;
+    case Op::MatVec:
+      result = getMatVecInterval(term);
+      break;
+    case Op::RotateLeftConst:
+    case Op::RotateRightConst:
+    case Op::Output:
+    case Op::Encode:
+    case Op::Relinearize:
+    case Op::ModSwitch:
+    case Op::Rescale:
+      result = intervals[term->operandAt(0)];
+      break;
+    default:
+      throw std::runtime_error("Unhandled op " + getOpName(term->op) +
+                               " when analyzing ranges");
+    }
+  }
+
+  const Interval &getInterval(const Term::Ptr &term) { return intervals[term]; }
+
+  // Bits such that the magnitude of the values and a sign fit into them
+  std::uint32_t getRangeBits(const Term::Ptr &term) {
+    double maxAbs = intervals[term].maxAbs();
+    if (maxAbs < 1) return 1;
+    return std::uint32_t(std::floor(std::log2(maxAbs))) + 2;
+  }
+};
+
+} // namespace eva
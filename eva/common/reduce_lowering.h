@@ -0,0 +1,248 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/common/rotation_keys_selector.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace eva {
+
+/*
+Lowers Reduce terms, which sum up count elements that are stride apart, into
+rotations and additions. Two kinds of schedules are considered:
+
+  - Rotate-and-add doubling, which computes the sums of 2^i elements with one
+    rotation each, and needs about log2(count) rotations for powers of two and
+    up to twice that otherwise.
+  - Baby-step giant-step, which sums up b rotations of the input and then
+    count / b rotations of that partial sum. The baby steps all rotate the same
+    ciphertext and are independent of each other.
+
+The schedule with the lowest cost is chosen. While the program's rotation keys
+fit into the budget of maxRotationKeys, or when there is no budget, each
+rotation counts as one and so does each step that no other rotation of an
+encrypted value uses, as new steps need additional rotation keys. Beyond the
+budget RotationDecomposer turns rotations into chains of rotations by the keys
+from getRadixRotationKeys, so each rotation counts as the length of its chain
+and new steps cost nothing. Rotations of raw values need no keys. The baby steps
+rotate the same ciphertext, but are not hoisted, so each is costed as a rotation
+of its own. Use with a forward pass to gather the rotation steps the program
+uses and the Reduce terms, and then call lower. The rewrite is deferred because
+the traversal does not reach the uses of a term once they are rewired to a
+replacement made of several new terms. Must run after TypeDeducer and before
+ConstantFolder, as the other passes do not handle Reduce terms. With
+keepCosetReductions, Reduce terms of ciphertexts that sum whole cosets are left
+for InstancePacker, which lowers them without masking. Reductions of unencrypted
+values are always lowered, as ConstantFolder may fold their operands into
+constants.
+*/
+class ReduceLowering {
+  Program &program;
+  TermMap<Type> &type;
+  bool keepCosetReductions;
+  std::uint32_t maxRotationKeys;
+  std::set<std::uint32_t> existingSteps;
+  // Rotations by radix keys needed for each step, computed when first needed
+  std::vector<std::uint32_t> radixDistance;
+  std::vector<Term::Ptr> reductions;
+
+  struct Schedule {
+    std::uint32_t babySteps; // Zero for the doubling schedule
+    std::vector<std::uint32_t> steps;
+  };
+
+  std::uint32_t normalize(std::uint64_t slots) {
+    return slots % program.getVecSize();
+  }
+
+  Schedule getDoublingSchedule(std::uint32_t stride, std::uint32_t count) {
+    Schedule schedule{0, {}};
+    std::uint32_t bit = 1;
+    while (2 * bit <= count) {
+      bit *= 2;
+    }
+    std::uint64_t summed = 1;
+    for (bit /= 2; bit > 0; bit /= 2) {
+      schedule.steps.push_back(normalize(summed * stride));
+      summed *= 2;
+      if (count & bit) {
+        schedule.steps.push_back(normalize(stride));
+        summed += 1;
+      }
+    }
+    return schedule;
+  }
+
+  Schedule getBabyStepGiantStepSchedule(std::uint32_t stride,
+                                        std::uint32_t count,
+                                        std::uint32_t babySteps) {
+    Schedule schedule{babySteps, {}};
+    for (std::uint64_t i = 1; i < babySteps; ++i) {
+      schedule.steps.push_back(normalize(i * stride));
+    }
+    for (std::uint64_t i = babySteps; i < count; i += babySteps) {
+      schedule.steps.push_back(normalize(i * stride));
+    }
+    return schedule;
+  }
+
+  std::uint32_t getRadixDistance(std::uint32_t step) {
+    if (radixDistance.empty()) {
+      auto vecSize = program.getVecSize();
+      auto keys = getRadixRotationKeys(vecSize, maxRotationKeys);
+      radixDistance.assign(vecSize, std::numeric_limits<std::uint32_t>::max());
+      radixDistance[0] = 0;
+      std::deque<std::uint32_t> queue = {0};
+      while (!queue.empty()) {
+        auto current = queue.front();
+        queue.pop_front();
+        for (auto key : keys) {
+          auto next = (current + key) % vecSize;
+          if (radixDistance[next] !=
+              std::numeric_limits<std::uint32_t>::max()) {
+            continue;
+          }
+          radixDistance[next] = radixDistance[current] + 1;
+          queue.push_back(next);
+        }
+      }
+    }
+    return radixDistance[step];
+  }
+
+  std::size_t getCost(const Schedule &schedule, bool needsKeys) {
+    std::set<std::uint32_t> newSteps;
+    std::size_t rotations = 0;
+    for (auto step : schedule.steps) {
+      if (step == 0) continue;
+      ++rotations;
+      if (needsKeys && !existingSteps.count(step)) newSteps.insert(step);
+    }
+    if (!needsKeys || maxRotationKeys == 0 ||
+        existingSteps.size() + newSteps.size() <= maxRotationKeys) {
+      return rotations + newSteps.size();
+    }
+    std::size_t decomposed = 0;
+    for (auto step : schedule.steps) {
+      if (step != 0) decomposed += getRadixDistance(step);
+    }
+    return decomposed;
+  }
+
+  Term::Ptr rotate(const Term::Ptr &term, std::uint32_t step) {
+    if (step == 0) return term;
+    return program.makeLeftRotation(term, step);
+  }
+
+  Term::Ptr lowerDoubling(const Term::Ptr &x, std::uint32_t stride,
+                          std::uint32_t count) {
+    std::uint32_t bit = 1;
+    while (2 * bit <= count) {
+      bit *= 2;
+    }
+    auto sum = x;
+    std::uint64_t summed = 1;
+    for (bit /= 2; bit > 0; bit /= 2) {
+      sum = program.makeTerm(Op::Add,
+                             {sum, rotate(sum, normalize(summed * stride))});
+      summed *= 2;
+      if (count & bit) {
+        sum = program.makeTerm(Op::Add, {x, rotate(sum, normalize(stride))});
+        summed += 1;
+      }
+    }
+    return sum;
+  }
+
+  Term::Ptr lowerBabyStepGiantStep(const Term::Ptr &x, std::uint32_t stride,
+                                   std::uint32_t count,
+                                   std::uint32_t babySteps) {
+    auto inner = x;
+    for (std::uint64_t i = 1; i < babySteps; ++i) {
+      inner = program.makeTerm(Op::Add,
+                               {inner, rotate(x, normalize(i * stride))});
+    }
+    auto sum = inner;
+    for (std::uint64_t i = babySteps; i < count; i += babySteps) {
+      sum = program.makeTerm(Op::Add,
+                             {sum, rotate(inner, normalize(i * stride))});
+    }
+    return sum;
+  }
+
+  void lowerReduction(const Term::Ptr &term) {
+    auto stride = term->get<ReduceStrideAttribute>();
+    auto count = term->get<ReduceCountAttribute>();
+    if (count == 0) {
+      throw std::runtime_error("Reduce terms must sum at least one element");
+    }
+    if (keepCosetReductions && type[term->operandAt(0)] == Type::Cipher &&
+        std::uint64_t(stride) * count == program.getVecSize()) {
+      return;
+    }
+
+    // Baby steps must divide the count, so that all giant steps are full
+    bool needsKeys = type[term->operandAt(0)] != Type::Raw;
+    auto best = getDoublingSchedule(stride, count);
+    auto bestCost = getCost(best, needsKeys);
+    for (std::uint32_t babySteps = 2; babySteps <= count; babySteps *= 2) {
+      if (count % babySteps != 0) break;
+      auto schedule = getBabyStepGiantStepSchedule(stride, count, babySteps);
+      auto cost = getCost(schedule, needsKeys);
+      if (cost < bestCost) {
+        best = schedule;
+        bestCost = cost;
+      }
+    }
+
+    auto x = term->operandAt(0);
+    auto result = best.babySteps == 0
+                      ? lowerDoubling(x, stride, count)
+                      : lowerBabyStepGiantStep(x, stride, count,
+                                               best.babySteps);
+    for (auto step : best.steps) {
+      if (step != 0 && needsKeys) existingSteps.insert(step);
+    }
+    term->replaceAllUsesWith(result);
+  }
+
+public:
+  ReduceLowering(Program &g, TermMap<Type> &type,
+                 bool keepCosetReductions = false,
+                 std::uint32_t maxRotationKeys = 0)
+      : program(g), type(type), keepCosetReductions(keepCosetReductions),
+        maxRotationKeys(maxRotationKeys) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (term->op == Op::Reduce) {
+      reductions.push_back(term);
+      return;
+    }
+    if (term->op != Op::RotateLeftConst && term->op != Op::RotateRightConst) {
+      return;
+    }
+    if (type[term] == Type::Raw) return;
+    std::int64_t vecSize = program.getVecSize();
+    std::int64_t slots = term->get<RotationAttribute>();
+    if (term->op == Op::RotateRightConst) slots = -slots;
+    existingSteps.insert(((slots % vecSize) + vecSize) % vecSize);
+  }
+
+  void lower() {
+    for (auto &term : reductions) {
+      lowerReduction(term);
+    }
+    reductions.clear();
+  }
+};
+
+} // namespace eva
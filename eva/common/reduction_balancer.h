@@ -5,7 +5,14 @@
 
 #include "eva/ir/program.h"
 #include "eva/ir/term_map.h"
+#include <cassert>
+#include <cstddef>
+#include <functional>
 #include <numeric>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
 
 namespace eva {
 
@@ -57,17 +64,38 @@ public:
   }
 };
 
+/*
+Expands the flattened reductions left by ReductionCombiner into trees of binary
+operations. Like Huffman coding, the two operands that are expected to be at the
+lowest levels are combined first, and the result is put back among the
+remaining operands at its own expected level, until only two remain. Constants,
+plaintexts and raw values come first, followed by ciphertexts ordered by their
+scale without any rescaling, which serves as a proxy for their level. The
+scale of a product is the sum of the scales of its operands, so it is ranked
+after both of them and shallow operands are multiplied together before they
+meet deep ones. The scale of a sum is the larger of the scales of its operands,
+which keeps the scales of combined operands close. Types of the new terms are
+read from the types being kept up to date by an IncrementalTypeDeducer, which
+must be observing the program.
+*/
 class ReductionLogExpander {
   Program &program;
   TermMap<Type> &type;
   TermMapOptional<int> scale;
-  std::vector<Term::Ptr> operands, nextOperands;
-  std::map<std::uint32_t, std::vector<Term::Ptr>> sortedOperands;
 
   bool isReductionOp(const Op &op_code) {
     return ((op_code == Op::Add) || (op_code == Op::Mul));
   }
 
+  int getOrder(Type operandType, int operandScale) {
+    if (operandType == Type::Plain || operandType == Type::Raw) {
+      return 1;
+    } else if (operandType == Type::Cipher) {
+      return 2 + operandScale;
+    }
+    return 0;
+  }
+
 public:
   ReductionLogExpander(Program &g, TermMap<Type> &type)
       : program(g), type(type), scale(g) {}
@@ -82,8 +110,8 @@ public:
 
     // Calculate the scales that we would get without any rescaling. Terms at a
     // similar scale will likely end up having the same level in typical
-    // rescaling policies, which helps the sorting group terms of the same level
-    // together.
+    // rescaling policies, which helps the ordering group terms of the same
+    // level together.
     if (term->numOperands() == 0) {
       scale[term] = term->get<EncodeAtScaleAttribute>();
     } else if (term->op == Op::Mul) {
@@ -99,48 +127,40 @@ public:
     }
 
     if (isReductionOp(term->op) && term->numOperands() > 2) {
-      // We sort operands into constants, plaintext and raw, then ciphertexts by
-      // scale. This helps avoid unnecessary accumulation of scale.
+      // Operands are ordered by their expected level and then by their
+      // position, which keeps the expansion deterministic
+      using Entry = std::tuple<int, std::size_t, Term::Ptr>;
+      std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>
+          queue;
+      std::size_t position = 0;
       for (auto &operand : term->getOperands()) {
-        auto order = 0;
-        if (type[operand] == Type::Plain || type[operand] == Type::Raw) {
-          order = 1;
-        } else if (type[operand] == Type::Cipher) {
-          order = 2 + scale.at(operand);
-        }
-        sortedOperands[order].push_back(operand);
-      }
-      for (auto &op : sortedOperands) {
-        operands.insert(operands.end(), op.second.begin(), op.second.end());
+        queue.emplace(getOrder(type[operand], scale.at(operand)), position++,
+                      operand);
       }
 
-      // Expand the sorted operands into a balanced reduction tree by pairing
-      // adjacent operands until only one remains.
-      assert(operands.size() >= 2);
-      while (operands.size() > 2) {
-        std::size_t i = 0;
-        while ((i + 1) < operands.size()) {
-          auto &leftOperand = operands[i];
-          auto &rightOperand = operands[i + 1];
-          auto newTerm =
-              program.makeTerm(term->op, {leftOperand, rightOperand});
-          nextOperands.push_back(newTerm);
-          i += 2;
+      assert(queue.size() >= 2);
+      while (queue.size() > 2) {
+        auto leftOperand = std::get<2>(queue.top());
+        queue.pop();
+        auto rightOperand = std::get<2>(queue.top());
+        queue.pop();
+        // The type of the new term is deduced by the IncrementalTypeDeducer
+        // that is observing the program
+        auto newTerm = program.makeTerm(term->op, {leftOperand, rightOperand});
+        if (term->op == Op::Mul) {
+          scale[newTerm] = scale.at(leftOperand) + scale.at(rightOperand);
+        } else {
+          scale[newTerm] =
+              std::max(scale.at(leftOperand), scale.at(rightOperand));
         }
-        if (i < operands.size()) {
-          assert((i + 1) == operands.size());
-          nextOperands.push_back(operands[i]);
-        }
-        operands = nextOperands;
-        nextOperands.clear();
+        queue.emplace(getOrder(type[newTerm], scale.at(newTerm)), position++,
+                      newTerm);
       }
 
-      assert(operands.size() == 2);
-      term->setOperands(operands);
-
-      operands.clear();
-      nextOperands.clear();
-      sortedOperands.clear();
+      auto leftOperand = std::get<2>(queue.top());
+      queue.pop();
+      auto rightOperand = std::get<2>(queue.top());
+      term->setOperands({leftOperand, rightOperand});
     }
   }
 };
@@ -57,6 +57,48 @@ void ReferenceExecutor::negate(vector<double> &output, const Term::Ptr &args) {
             std::negate<double>());
 }
 
+void ReferenceExecutor::polynomial(vector<double> &output,
+                                   const vector<Term::Ptr> &args) {
+  auto &input = terms_.at(args[0]);
+
+  // Evaluate with Horner's method starting from the highest coefficient
+  output = terms_.at(args.back());
+  for (size_t i = args.size() - 2; i > 0; --i) {
+    auto &coefficient = terms_.at(args[i]);
+    for (size_t j = 0; j < output.size(); ++j) {
+      output[j] = output[j] * input[j] + coefficient[j];
+    }
+  }
+}
+
+void ReferenceExecutor::matVec(vector<double> &output,
+                               const vector<Term::Ptr> &args) {
+  auto &input = terms_.at(args[0]);
+
+  // Sum up the diagonals multiplied with the correspondingly rotated input
+  output.assign(input.size(), 0);
+  for (size_t i = 1; i < args.size(); ++i) {
+    auto &diagonal = terms_.at(args[i]);
+    auto shift = i - 1;
+    for (size_t j = 0; j < output.size(); ++j) {
+      output[j] += diagonal[j] * input[(j + shift) % input.size()];
+    }
+  }
+}
+
+void ReferenceExecutor::reduce(vector<double> &output, const Term::Ptr &args,
+                               uint32_t stride, uint32_t count) {
+  auto &input = terms_.at(args);
+
+  // Sum up count elements that are stride apart, wrapping around cyclically
+  output.assign(input.size(), 0);
+  for (size_t j = 0; j < output.size(); ++j) {
+    for (uint64_t i = 0; i < count; ++i) {
+      output[j] += input[(j + i * stride) % input.size()];
+    }
+  }
+}
+
 void ReferenceExecutor::operator()(const Term::Ptr &term) {
   // Must only be used with forward pass traversal
   auto &output = terms_[term];
@@ -96,6 +138,19 @@ void ReferenceExecutor::operator()(const Term::Ptr &term) {
     assert(args.size() == 1);
     negate(output, args[0]);
     break;
+  case Op::Polynomial:
+    assert(args.size() >= 2);
+    polynomial(output, args);
+    break;
+  case Op::MatVec:
+    assert(args.size() >= 2);
+    matVec(output, args);
+    break;
+  case Op::Reduce:
+    assert(args.size() == 1);
+    reduce(output, args[0], term->get<ReduceStrideAttribute>(),
+           term->get<ReduceCountAttribute>());
+    break;
   case Op::Encode:
     [[fallthrough]];
   case Op::Output:
@@ -51,11 +51,13 @@ public:
     }
   }
 
-private:
+protected:
   Program &program_;
   std::uint64_t vecSize_;
   TermMapOptional<std::vector<double>> terms_;
 
+private:
+
   template <class Op>
   void binOp(std::vector<double> &out, const Term::Ptr &args1,
              const Term::Ptr &args2) {
@@ -75,6 +77,14 @@ private:
                    std::int32_t shift);
 
   void negate(std::vector<double> &output, const Term::Ptr &args);
+
+  void polynomial(std::vector<double> &output,
+                  const std::vector<Term::Ptr> &args);
+
+  void matVec(std::vector<double> &output, const std::vector<Term::Ptr> &args);
+
+  void reduce(std::vector<double> &output, const Term::Ptr &args,
+              std::uint32_t stride, std::uint32_t count);
 };
 
 } // namespace eva
@@ -0,0 +1,90 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace eva {
+
+/*
+Groups the rotations of each term by the effective rotation step, so that a
+ciphertext is rotated at most once per step. Rotations are cyclic in the vector
+size, so for example x << 60 and x >> 4 with a vector size of 64 are the same
+rotation, which CommonSubexpressionEliminator does not detect. Each group is
+replaced by a single rotation in the direction with the smaller step, which
+also lets rotations in both directions share rotation keys. Rotations by
+distinct steps are left as they are. Each still does its own key switching, as
+nothing here hoists the decomposition of the ciphertext across them.
+*/
+class RotationCanonicalizer {
+  Program &program;
+
+  bool isRotation(const Term::Ptr &term) {
+    return term->op == Op::RotateLeftConst || term->op == Op::RotateRightConst;
+  }
+
+  std::uint32_t getLeftStep(const Term::Ptr &rotation) {
+    std::int64_t vecSize = program.getVecSize();
+    std::int64_t slots = rotation->get<RotationAttribute>();
+    if (rotation->op == Op::RotateRightConst) slots = -slots;
+    return ((slots % vecSize) + vecSize) % vecSize;
+  }
+
+  bool isCanonical(const Term::Ptr &rotation, std::uint32_t step) {
+    auto vecSize = program.getVecSize();
+    if (step <= vecSize / 2) {
+      return rotation->op == Op::RotateLeftConst &&
+             rotation->get<RotationAttribute>() == std::int64_t(step);
+    }
+    return rotation->op == Op::RotateRightConst &&
+           rotation->get<RotationAttribute>() == std::int64_t(vecSize - step);
+  }
+
+  Term::Ptr makeCanonical(const Term::Ptr &term, std::uint32_t step) {
+    auto vecSize = program.getVecSize();
+    if (step <= vecSize / 2) {
+      return program.makeLeftRotation(term, step);
+    }
+    return program.makeRightRotation(term, vecSize - step);
+  }
+
+public:
+  RotationCanonicalizer(Program &g) : program(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    // Group the rotations of term in the order of their indices, so that the
+    // result is deterministic
+    std::map<std::uint32_t, std::map<std::uint64_t, Term::Ptr>> groups;
+    for (auto &use : term->getUses()) {
+      if (isRotation(use)) {
+        groups[getLeftStep(use)].emplace(use->index, use);
+      }
+    }
+
+    for (auto &[step, rotations] : groups) {
+      if (step == 0) {
+        // RotationFolder normally removes these already
+        for (auto &entry : rotations) {
+          entry.second->replaceAllUsesWith(term);
+        }
+        continue;
+      }
+      auto canonical = rotations.begin()->second;
+      if (!isCanonical(canonical, step)) {
+        canonical = makeCanonical(term, step);
+      }
+      for (auto &entry : rotations) {
+        if (entry.second != canonical) {
+          entry.second->replaceAllUsesWith(canonical);
+        }
+      }
+    }
+  }
+};
+
+} // namespace eva
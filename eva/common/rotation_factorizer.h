@@ -0,0 +1,247 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+/*
+Factors rotations out of sums to reduce the number of ciphertext rotations.
+Rotations by the same offset distribute over addition and subtraction, so
+
+  (a << k) + (b << k) -> (a + b) << k
+
+and they can be moved past multiplications with constants by rotating the
+constant the other way at compile time:
+
+  (a << k) * c -> (a * (c >> k)) << k
+
+The summands of each sum are grouped by clustering their rotation offsets, and
+a summand a << (g + j) in the cluster starting at g is rewritten into the baby
+step a << j, which is shared between all clusters, followed by the giant step
+rotation << g of the whole cluster. For a 3x3 convolution of an image of width
+w, the offsets i * w + j need the baby steps 1, 2 and the giant steps w, 2w
+instead of 8 rotations. Each sum is only rewritten when this needs fewer
+rotations than before. Must run after ConstantFolder, as the constants are only
+recognized when they have been folded.
+*/
+class RotationFactorizer {
+  Program &program;
+  TermMapOptional<std::uint32_t> &scale;
+  std::map<std::pair<Term *, std::uint32_t>, Term::Ptr> babySteps;
+  std::vector<double> scratch;
+
+  struct Summand {
+    Term::Ptr term;
+    Term::Ptr base;     // Null if the summand is not a rotation
+    Term::Ptr constant; // Null if the rotation is not multiplied
+    std::uint32_t offset = 0;
+    bool negative = false;
+  };
+
+  bool isSummation(const Term::Ptr &term) {
+    return term->op == Op::Add || term->op == Op::Sub || term->op == Op::Negate;
+  }
+
+  bool isRotation(const Term::Ptr &term) {
+    return term->op == Op::RotateLeftConst || term->op == Op::RotateRightConst;
+  }
+
+  // Returns the rotation as a left rotation in [0, vecSize)
+  std::uint32_t getLeftOffset(const Term::Ptr &rotation) {
+    std::int64_t vecSize = program.getVecSize();
+    std::int64_t slots = rotation->get<RotationAttribute>();
+    if (rotation->op == Op::RotateRightConst) slots = -slots;
+    return ((slots % vecSize) + vecSize) % vecSize;
+  }
+
+  Summand match(const Term::Ptr &term, bool negative) {
+    Summand summand;
+    summand.term = term;
+    summand.negative = negative;
+    if (isRotation(term)) {
+      summand.base = term->operandAt(0);
+      summand.offset = getLeftOffset(term);
+    } else if (term->op == Op::Mul && term->numOperands() == 2) {
+      for (int i = 0; i < 2; ++i) {
+        auto rotation = term->operandAt(i);
+        auto constant = term->operandAt(1 - i);
+        if (isRotation(rotation) && constant->op == Op::Constant) {
+          summand.base = rotation->operandAt(0);
+          summand.constant = constant;
+          summand.offset = getLeftOffset(rotation);
+          break;
+        }
+      }
+    }
+    return summand;
+  }
+
+  // Collects the summands of the tree of single use additions, subtractions
+  // and negations rooted at term in depth first order. Uses an explicit stack,
+  // as the trees of long sums are deep.
+  void collect(const Term::Ptr &term, bool negative,
+               std::vector<Summand> &summands) {
+    std::vector<std::pair<Term::Ptr, bool>> stack;
+    auto pushOperands = [&](const Term::Ptr &sum, bool sumNegative) {
+      auto &operands = sum->getOperands();
+      // Push in reverse so that the first operand is collected first
+      for (std::size_t i = operands.size(); i-- > 0;) {
+        // Only the second operand of a subtraction is subtracted
+        bool operandNegative =
+            sumNegative !=
+            (sum->op == Op::Negate || (sum->op == Op::Sub && i == 1));
+        stack.emplace_back(operands[i], operandNegative);
+      }
+    };
+    pushOperands(term, negative);
+    while (!stack.empty()) {
+      auto [operand, operandNegative] = std::move(stack.back());
+      stack.pop_back();
+      if (isSummation(operand) && operand->numUses() == 1) {
+        pushOperands(operand, operandNegative);
+      } else {
+        summands.push_back(match(operand, operandNegative));
+      }
+    }
+  }
+
+  // Assigns each offset to a cluster starting at most maxSpread - 1 below it.
+  // The first cluster starts at zero, which needs no giant step rotation.
+  std::map<std::uint32_t, std::uint32_t>
+  cluster(const std::set<std::uint32_t> &offsets, std::uint32_t maxSpread) {
+    std::map<std::uint32_t, std::uint32_t> giantSteps;
+    std::uint32_t start = 0;
+    for (auto offset : offsets) {
+      if (offset - start >= maxSpread) {
+        start = offset;
+      }
+      giantSteps[offset] = start;
+    }
+    return giantSteps;
+  }
+
+  std::size_t
+  countRotations(const std::vector<Summand> &summands,
+                 const std::map<std::uint32_t, std::uint32_t> &giantSteps) {
+    std::set<std::uint32_t> giants;
+    std::set<std::pair<Term *, std::uint32_t>> babies;
+    for (auto &summand : summands) {
+      if (!summand.base) continue;
+      auto giant = giantSteps.at(summand.offset);
+      if (giant != 0) giants.insert(giant);
+      if (summand.offset != giant) {
+        babies.emplace(summand.base.get(), summand.offset - giant);
+      }
+    }
+    return giants.size() + babies.size();
+  }
+
+  Term::Ptr getBabyStep(const Term::Ptr &base, std::uint32_t offset) {
+    if (offset == 0) return base;
+    auto &baby = babySteps[{base.get(), offset}];
+    if (!baby) {
+      baby = program.makeLeftRotation(base, offset);
+    }
+    return baby;
+  }
+
+  // Returns constant >> slots, which is constant itself if it is uniform
+  Term::Ptr rotateConstant(const Term::Ptr &constant, std::uint32_t slots) {
+    if (slots == 0) return constant;
+    auto &values = constant->get<ConstantValueAttribute>()->expand(
+        scratch, program.getVecSize());
+    if (std::all_of(values.begin(), values.end(),
+                    [&](double value) { return value == values[0]; })) {
+      return constant;
+    }
+    std::vector<double> rotated(values.size());
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      rotated[(i + slots) % values.size()] = values[i];
+    }
+    auto result = program.makeDenseConstant(rotated);
+    scale[result] = scale[constant];
+    result->set<EncodeAtScaleAttribute>(scale[result]);
+    return result;
+  }
+
+  // Returns left + right or left - right, where a missing left is zero
+  Term::Ptr add(const Term::Ptr &left, const Term::Ptr &right, bool negative) {
+    if (!left) {
+      return negative ? program.makeTerm(Op::Negate, {right}) : right;
+    }
+    return program.makeTerm(negative ? Op::Sub : Op::Add, {left, right});
+  }
+
+public:
+  RotationFactorizer(Program &g, TermMapOptional<std::uint32_t> &scale)
+      : program(g), scale(scale) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (!isSummation(term)) return;
+    // Only rewrite whole sums, which are not themselves part of a larger sum
+    if (term->numUses() == 1 && isSummation(term->getUses()[0])) return;
+
+    std::vector<Summand> summands;
+    collect(term, false, summands);
+
+    std::set<std::uint32_t> offsets;
+    std::set<std::pair<Term *, std::uint32_t>> rotations;
+    for (auto &summand : summands) {
+      if (!summand.base) continue;
+      offsets.insert(summand.offset);
+      if (summand.offset != 0) {
+        rotations.emplace(summand.base.get(), summand.offset);
+      }
+    }
+    if (rotations.size() < 2) return;
+
+    // Find the cluster size with the fewest rotations, preferring small ones
+    std::map<std::uint32_t, std::uint32_t> bestGiantSteps;
+    std::size_t bestCount = rotations.size();
+    for (std::uint32_t spread = 2; spread <= program.getVecSize();
+         spread *= 2) {
+      auto giantSteps = cluster(offsets, spread);
+      auto count = countRotations(summands, giantSteps);
+      if (count < bestCount) {
+        bestCount = count;
+        bestGiantSteps = std::move(giantSteps);
+      }
+    }
+    if (bestGiantSteps.empty()) return;
+
+    std::map<std::uint32_t, Term::Ptr> clusters;
+    Term::Ptr result;
+    for (auto &summand : summands) {
+      if (!summand.base) {
+        result = add(result, summand.term, summand.negative);
+        continue;
+      }
+      auto giant = bestGiantSteps.at(summand.offset);
+      auto rotated = getBabyStep(summand.base, summand.offset - giant);
+      if (summand.constant) {
+        rotated = program.makeTerm(
+            Op::Mul, {rotated, rotateConstant(summand.constant, giant)});
+      }
+      clusters[giant] = add(clusters[giant], rotated, summand.negative);
+    }
+    for (auto &[giant, sum] : clusters) {
+      result = add(result,
+                   giant == 0 ? sum : program.makeLeftRotation(sum, giant),
+                   false);
+    }
+    term->replaceAllUsesWith(result);
+  }
+};
+
+} // namespace eva
@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include <cstdint>
+
+namespace eva {
+
+/*
+Folds chains of rotations into a single rotation, e.g., (x << a) >> b becomes
+x << (a - b), and removes rotations by multiples of the vector size. Rotations
+are cyclic in the vector size, so the folded rotation is normalized to a left
+rotation between 1 and vecSize - 1.
+*/
+class RotationFolder {
+  Program &program;
+
+  bool isRotation(const Term::Ptr &term) {
+    return term->op == Op::RotateLeftConst || term->op == Op::RotateRightConst;
+  }
+
+  std::int64_t getLeftRotation(const Term::Ptr &rotation) {
+    std::int64_t slots = rotation->get<RotationAttribute>();
+    return rotation->op == Op::RotateRightConst ? -slots : slots;
+  }
+
+public:
+  RotationFolder(Program &g) : program(g) {}
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    if (!isRotation(term)) return;
+
+    // Operands are visited first, so at most one rotation needs to be folded
+    auto operand = term->operandAt(0);
+    std::int64_t slots = getLeftRotation(term);
+    if (isRotation(operand)) {
+      slots += getLeftRotation(operand);
+      operand = operand->operandAt(0);
+    }
+
+    std::int64_t vecSize = program.getVecSize();
+    slots = ((slots % vecSize) + vecSize) % vecSize;
+    if (slots == 0) {
+      term->replaceAllUsesWith(operand);
+    } else if (operand != term->operandAt(0)) {
+      term->replaceAllUsesWith(program.makeLeftRotation(operand, slots));
+    }
+  }
+};
+
+} // namespace eva
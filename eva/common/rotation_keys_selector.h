@@ -12,6 +12,23 @@
 
 namespace eva {
 
+// Returns the powers of the smallest power of two radix that fit into a budget
+// of maxKeys rotation keys. Every rotation step is a sum of these, so
+// RotationDecomposer always includes them when a program needs more keys than
+// the budget allows.
+inline std::set<std::uint32_t> getRadixRotationKeys(std::uint64_t vecSize,
+                                                    std::uint32_t maxKeys) {
+  std::set<std::uint32_t> keys;
+  for (std::uint64_t radix = 2;; radix *= 2) {
+    keys.clear();
+    for (std::uint64_t power = 1; power < vecSize; power *= radix) {
+      keys.insert(power);
+    }
+    if (keys.size() <= maxKeys || radix >= vecSize) break;
+  }
+  return keys;
+}
+
 class RotationKeysSelector {
 public:
   RotationKeysSelector(Program &g, const TermMap<Type> &type)
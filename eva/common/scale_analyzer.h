@@ -0,0 +1,118 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/common/range_analyzer.h"
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+
+namespace eva {
+
+/*
+Computes for every term how much an absolute error in its value may grow by the
+time it reaches the outputs, using the bounds found by RangeAnalyzer. Errors
+pass through additions and rotations unchanged, are multiplied by the largest
+magnitude of the other operand in multiplications and by the count in
+reductions, and by the largest derivative in polynomials. The amplifications
+along each use are summed up, which bounds the error in any output to first
+order. An input or constant encoded at a scale of s bits has an error of about
+2^-s, so getScale gives the scale that keeps the outputs precise to the given
+number of bits. Use with a backward pass after the forward pass of the
+RangeAnalyzer.
+*/
+class ScaleAnalyzer {
+  Program &program;
+  RangeAnalyzer &ranges;
+  TermMap<double> amplifications;
+
+  // Bounds the change of use when its i-th operand changes by one
+  double getPartial(const Term::Ptr &use, std::size_t i) {
+    auto &operands = use->getOperands();
+    switch (use->op) {
+    case Op::Add:
+    case Op::Sub:
+    case Op::Negate:
+    case Op::RotateLeftConst:
+    case Op::RotateRightConst:
+    case Op::Output:
+    case Op::Encode:
+    case Op::Relinearize:
+    case Op::ModSwitch:
+    case Op::Rescale:
+      return 1;
+    case Op::Mul:
+      return ranges.getInterval(operands[1 - i]).maxAbs();
+    case Op::Reduce:
+      return use->get<ReduceCountAttribute>();
+    case Op::MatVec:
+      if (i == 0) {
+        double sum = 0;
+        for (std::size_t j = 1; j < operands.size(); ++j) {
+          sum += ranges.getInterval(operands[j]).maxAbs();
+        }
+        return sum;
+      }
+      return ranges.getInterval(operands[0]).maxAbs();
+    case Op::Polynomial: {
+      double x = ranges.getInterval(operands[0]).maxAbs();
+      if (i > 0) return std::pow(x, i - 1);
+      // The derivative of the sum of c_k * x^k is bounded by the sum of
+      // k * |c_k| * |x|^(k-1)
+      double derivative = 0;
+      for (std::size_t k = 1; k + 1 < operands.size(); ++k) {
+        derivative += k * ranges.getInterval(operands[k + 1]).maxAbs() *
+                      std::pow(x, k - 1);
+      }
+      return derivative;
+    }
+    default:
+      throw std::runtime_error("Unhandled op " + getOpName(use->op) +
+                               " when analyzing scales");
+    }
+  }
+
+public:
+  ScaleAnalyzer(Program &g, RangeAnalyzer &ranges)
+      : program(g), ranges(ranges), amplifications(g) {}
+
+  void operator()(
+      Term::Ptr &term) { // must only be used with backward pass traversal
+    auto &amplification = amplifications[term];
+    if (term->op == Op::Output) {
+      amplification = 1;
+      return;
+    }
+    amplification = 0;
+    // A use appears once for each of its operands that is this term
+    std::set<Term *> visited;
+    for (auto &use : term->getUses()) {
+      if (!visited.insert(use.get()).second) continue;
+      auto &operands = use->getOperands();
+      for (std::size_t i = 0; i < operands.size(); ++i) {
+        if (operands[i] == term) {
+          amplification += amplifications[use] * getPartial(use, i);
+        }
+      }
+    }
+  }
+
+  double getAmplification(const Term::Ptr &term) {
+    return amplifications[term];
+  }
+
+  // Scales never go below precision, even if errors shrink
+  std::uint32_t getScale(const Term::Ptr &term, std::uint32_t precision) {
+    double amplification = amplifications[term];
+    if (amplification <= 1) return precision;
+    return precision + std::uint32_t(std::ceil(std::log2(amplification)));
+  }
+};
+
+} // namespace eva
@@ -4,10 +4,33 @@
 #pragma once
 
 #include "eva/ir/program.h"
+#include "eva/ir/program_observer.h"
 #include "eva/ir/term_map.h"
+#include <vector>
 
 namespace eva {
 
+// Deduces the type of term from the types of its operands
+inline Type deduceType(const Term &term, const TermMap<Type> &types) {
+  auto &operands = term.getOperands();
+  if (operands.size() > 0) {   // not an input/root
+    Type inferred = Type::Raw; // Plain if not Cipher
+    for (auto &operand : operands) {
+      if (types[operand] == Type::Cipher)
+        inferred = Type::Cipher; // Cipher if any operand is Cipher
+    }
+    if (term.op == Op::Encode) {
+      return Type::Plain;
+    } else {
+      return inferred;
+    }
+  } else if (term.op == Op::Constant) {
+    return Type::Raw;
+  } else {
+    return term.get<TypeAttribute>();
+  }
+}
+
 class TypeDeducer {
   Program &program;
   TermMap<Type> &types;
@@ -17,22 +40,42 @@ public:
 
   void
   operator()(Term::Ptr &term) { // must only be used with forward pass traversal
-    auto &operands = term->getOperands();
-    if (operands.size() > 0) {   // not an input/root
-      Type inferred = Type::Raw; // Plain if not Cipher
-      for (auto &operand : operands) {
-        if (types[operand] == Type::Cipher)
-          inferred = Type::Cipher; // Cipher if any operand is Cipher
+    types[term] = deduceType(*term, types);
+  }
+};
+
+/*
+Keeps types up to date while passes rewrite the program, so that the whole
+program does not need to be traversed with TypeDeducer after each of them.
+Construct after a forward pass of TypeDeducer. When the operands of a term
+change its type is deduced again, and if that changes the type, the uses of the
+term are deduced again too. Terms without operands are typed when they are
+first used, as the TypeAttribute of an input is set after it is made.
+*/
+class IncrementalTypeDeducer : public ProgramObserver {
+  TermMap<Type> &types;
+  std::vector<Term::Ptr> worklist;
+
+public:
+  IncrementalTypeDeducer(Program &g, TermMap<Type> &types)
+      : ProgramObserver(g), types(types) {}
+
+  void operandsChanged(Term &term) override {
+    worklist.push_back(term.shared_from_this());
+    while (!worklist.empty()) {
+      auto current = worklist.back();
+      worklist.pop_back();
+      for (auto &operand : current->getOperands()) {
+        if (operand->numOperands() == 0 && types[operand] == Type::Undef) {
+          types[operand] = deduceType(*operand, types);
+        }
       }
-      if (term->op == Op::Encode) {
-        types[term] = Type::Plain;
-      } else {
-        types[term] = inferred;
+      auto type = deduceType(*current, types);
+      if (types[current] == type) continue;
+      types[current] = type;
+      for (auto &use : current->getUses()) {
+        worklist.push_back(use);
       }
-    } else if (term->op == Op::Constant) {
-      types[term] = Type::Raw;
-    } else {
-      types[term] = term->get<TypeAttribute>();
     }
   }
 };
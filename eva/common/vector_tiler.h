@@ -0,0 +1,269 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term_map.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eva {
+
+// Returns the name of a tile of an input or output of a tiled program
+inline std::string getTileName(const std::string &name, std::uint32_t tile) {
+  return name + "#" + std::to_string(tile);
+}
+
+// Splits the name of a tile into the original name and the tile index
+inline std::pair<std::string, std::uint32_t>
+splitTileName(const std::string &tileName) {
+  auto separator = tileName.rfind('#');
+  if (separator == std::string::npos) {
+    throw std::runtime_error("Not the name of a tile: " + tileName);
+  }
+  return {tileName.substr(0, separator),
+          std::stoul(tileName.substr(separator + 1))};
+}
+
+/*
+Splits the vectors of a program into tiles of tileSize elements, producing a
+new program with a vector size of tileSize in which every term of the original
+program is represented by one term per tile. The inputs and outputs x are
+replaced by the tiles x#0, x#1, ... as named by getTileName.
+
+Elementwise operations are applied tile by tile. A left rotation by k = q *
+tileSize + r moves elements across tiles, so tile i of the result is
+
+  ((x_(i+q) << r) * low) + ((x_(i+q+1) << r) * high)
+
+where low masks the first tileSize - r elements and high the rest. Each tile is
+rotated once and the rotations are shared between the resulting tiles. Reduce
+terms summing whole cosets, such as horizontal sums, first add up the tiles and
+then reduce within the sum, which needs no masks. Must run before the other
+passes, and after the lowering of Polynomial and MatVec terms. Use with a
+forward pass over the original program, and then take the tiled program with
+getProgram.
+*/
+class VectorTiler {
+  Program &program;
+  std::unique_ptr<Program> tiled;
+  std::uint32_t tileSize;
+  std::uint32_t tileCount;
+  std::uint32_t maskScale = 0;
+  TermMap<std::vector<Term::Ptr>> tiles;
+  std::unordered_map<Term *, std::string> outputNames;
+  std::vector<double> scratch;
+
+  // Makes a tile of original, or a mask if original is null
+  Term::Ptr makeConstant(const Term::Ptr &original,
+                         std::vector<double> values) {
+    auto constant = tiled->makeTerm(Op::Constant);
+    if (original) constant->assignAttributesFrom(*original);
+    if (std::all_of(values.begin(), values.end(),
+                    [&](double value) { return value == values[0]; })) {
+      values.resize(1);
+    }
+    constant->set<ConstantValueAttribute>(
+        std::make_shared<DenseConstantValue>(tileSize, values));
+    if (!original) constant->set<EncodeAtScaleAttribute>(maskScale);
+    return constant;
+  }
+
+  void tileConstant(const Term::Ptr &term, std::vector<Term::Ptr> &result) {
+    auto &values = term->get<ConstantValueAttribute>()->expand(
+        scratch, program.getVecSize());
+    if (std::all_of(values.begin(), values.end(),
+                    [&](double value) { return value == values[0]; })) {
+      result.assign(tileCount, makeConstant(term, {values[0]}));
+      return;
+    }
+    for (std::uint32_t i = 0; i < tileCount; ++i) {
+      auto begin = values.begin() + std::size_t(i) * tileSize;
+      result.push_back(
+          makeConstant(term, std::vector<double>(begin, begin + tileSize)));
+    }
+  }
+
+  // Rotates the vector represented by operands left by slots
+  std::vector<Term::Ptr> rotate(const std::vector<Term::Ptr> &operands,
+                                std::int64_t slots) {
+    std::int64_t vecSize = program.getVecSize();
+    slots = ((slots % vecSize) + vecSize) % vecSize;
+    std::uint32_t shift = slots / tileSize;
+    std::uint32_t rotation = slots % tileSize;
+
+    std::vector<Term::Ptr> result;
+    if (rotation == 0) {
+      for (std::uint32_t i = 0; i < tileCount; ++i) {
+        result.push_back(operands[(i + shift) % tileCount]);
+      }
+      return result;
+    }
+
+    std::vector<Term::Ptr> rotated;
+    for (auto &operand : operands) {
+      rotated.push_back(tiled->makeLeftRotation(operand, rotation));
+    }
+    std::vector<double> lowValues(tileSize, 0);
+    std::fill(lowValues.begin(), lowValues.end() - rotation, 1);
+    std::vector<double> highValues(tileSize, 1);
+    std::fill(highValues.begin(), highValues.end() - rotation, 0);
+    auto low = makeConstant(nullptr, lowValues);
+    auto high = makeConstant(nullptr, highValues);
+    for (std::uint32_t i = 0; i < tileCount; ++i) {
+      auto lowPart = tiled->makeTerm(
+          Op::Mul, {rotated[(i + shift) % tileCount], low});
+      auto highPart = tiled->makeTerm(
+          Op::Mul, {rotated[(i + shift + 1) % tileCount], high});
+      result.push_back(tiled->makeTerm(Op::Add, {lowPart, highPart}));
+    }
+    return result;
+  }
+
+  std::vector<Term::Ptr> add(const std::vector<Term::Ptr> &left,
+                             const std::vector<Term::Ptr> &right) {
+    std::vector<Term::Ptr> result;
+    for (std::uint32_t i = 0; i < tileCount; ++i) {
+      result.push_back(tiled->makeTerm(Op::Add, {left[i], right[i]}));
+    }
+    return result;
+  }
+
+  void tileReduction(const Term::Ptr &term, std::vector<Term::Ptr> &result) {
+    std::uint64_t stride = term->get<ReduceStrideAttribute>();
+    std::uint32_t count = term->get<ReduceCountAttribute>();
+    auto &operands = tiles[term->operandAt(0)];
+    if (count == 0) {
+      throw std::runtime_error("Reduce terms must sum at least one element");
+    }
+
+    // Reductions over whole cosets, such as horizontal sums, are done across
+    // tiles first, which needs no masking
+    if (stride * count == program.getVecSize()) {
+      if (tileSize % stride == 0) {
+        auto sum = operands[0];
+        for (std::uint32_t i = 1; i < tileCount; ++i) {
+          sum = tiled->makeTerm(Op::Add, {sum, operands[i]});
+        }
+        result.assign(tileCount,
+                      tiled->makeReduction(sum, stride, tileSize / stride));
+      } else {
+        std::uint32_t shift = stride / tileSize;
+        for (std::uint32_t i = 0; i < tileCount; ++i) {
+          auto sum = operands[i];
+          for (std::uint32_t j = 1; j < count; ++j) {
+            sum = tiled->makeTerm(
+                Op::Add, {sum, operands[(i + j * shift) % tileCount]});
+          }
+          result.push_back(sum);
+        }
+      }
+      return;
+    }
+
+    // Otherwise rotate and add with doubling as in ReduceLowering
+    std::uint32_t bit = 1;
+    while (2 * bit <= count) {
+      bit *= 2;
+    }
+    auto sum = operands;
+    std::uint64_t summed = 1;
+    for (bit /= 2; bit > 0; bit /= 2) {
+      sum = add(sum, rotate(sum, summed * stride));
+      summed *= 2;
+      if (count & bit) {
+        sum = add(operands, rotate(sum, stride));
+        summed += 1;
+      }
+    }
+    result = sum;
+  }
+
+public:
+  VectorTiler(Program &g, std::uint32_t tileSize)
+      : program(g), tiled(std::make_unique<Program>(g.getName(), tileSize)),
+        tileSize(tileSize), tileCount(g.getVecSize() / tileSize), tiles(g) {
+    if (g.getVecSize() % tileSize != 0) {
+      throw std::runtime_error("Tile size must divide the vector size");
+    }
+    for (auto &entry : g.getOutputs()) {
+      outputNames.emplace(entry.second.get(), entry.first);
+    }
+    // Encode masks at the largest scale of any input or constant
+    for (auto &source : g.getSources()) {
+      if (source->has<EncodeAtScaleAttribute>()) {
+        maskScale =
+            std::max(maskScale, source->get<EncodeAtScaleAttribute>());
+      }
+    }
+  }
+
+  void
+  operator()(Term::Ptr &term) { // must only be used with forward pass traversal
+    auto &result = tiles[term];
+    switch (term->op) {
+    case Op::Input:
+      for (auto &entry : program.getInputs()) {
+        if (entry.second != term) continue;
+        for (std::uint32_t i = 0; i < tileCount; ++i) {
+          auto input = tiled->makeInput(getTileName(entry.first, i));
+          input->assignAttributesFrom(*term);
+          result.push_back(input);
+        }
+      }
+      break;
+    case Op::Output: {
+      auto &operands = tiles[term->operandAt(0)];
+      for (std::uint32_t i = 0; i < tileCount; ++i) {
+        auto output = tiled->makeOutput(
+            getTileName(outputNames.at(term.get()), i), operands[i]);
+        output->assignAttributesFrom(*term);
+        result.push_back(output);
+      }
+    } break;
+    case Op::Constant:
+      tileConstant(term, result);
+      break;
+    case Op::RotateLeftConst:
+      result =
+          rotate(tiles[term->operandAt(0)], term->get<RotationAttribute>());
+      break;
+    case Op::RotateRightConst:
+      result =
+          rotate(tiles[term->operandAt(0)], -term->get<RotationAttribute>());
+      break;
+    case Op::Reduce:
+      tileReduction(term, result);
+      break;
+    case Op::Negate:
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+      for (std::uint32_t i = 0; i < tileCount; ++i) {
+        auto tile = tiled->makeTerm(term->op);
+        tile->assignAttributesFrom(*term);
+        for (auto &operand : term->getOperands()) {
+          tile->addOperand(tiles[operand][i]);
+        }
+        result.push_back(tile);
+      }
+      break;
+    default:
+      throw std::runtime_error("Unhandled op " + getOpName(term->op) +
+                               " when tiling vectors");
+    }
+  }
+
+  std::uint32_t getTileCount() { return tileCount; }
+
+  std::unique_ptr<Program> getProgram() { return std::move(tiled); }
+};
+
+} // namespace eva
@@ -2,8 +2,11 @@
 // Licensed under the MIT license.
 
 #include "eva/eva.h"
+#include "eva/ckks/noise_simulating_executor.h"
 #include "eva/common/program_traversal.h"
+#include "eva/common/range_analyzer.h"
 #include "eva/common/reference_executor.h"
+#include "eva/common/scale_analyzer.h"
 #include "eva/common/valuation.h"
 
 namespace eva {
@@ -20,4 +23,35 @@ Valuation evaluate(Program &program, const Valuation &inputs) {
   return outputs;
 }
 
+Valuation simulate(Program &program, const CKKSParameters &params,
+                   const Valuation &inputs, std::uint64_t seed) {
+  Valuation outputs;
+  ProgramTraversal programTraverse(program);
+  NoiseSimulatingExecutor executor(program, params, seed);
+
+  executor.setInputs(inputs);
+  programTraverse.forwardPass(executor);
+  executor.getOutputs(outputs);
+
+  return outputs;
+}
+
+void setInputBounds(
+    Program &program,
+    const std::unordered_map<std::string, std::pair<double, double>> &bounds,
+    std::uint32_t precision) {
+  ProgramTraversal programTraverse(program);
+  RangeAnalyzer ranges(program, bounds);
+  programTraverse.forwardPass(ranges);
+  ScaleAnalyzer scales(program, ranges);
+  programTraverse.backwardPass(scales);
+
+  for (auto &entry : program.getOutputs()) {
+    entry.second->set<RangeAttribute>(ranges.getRangeBits(entry.second));
+  }
+  for (auto &source : program.getSources()) {
+    source->set<EncodeAtScaleAttribute>(scales.getScale(source, precision));
+  }
+}
+
 } // namespace eva
@@ -8,9 +8,26 @@
 #include "eva/seal/seal.h"
 #include "eva/serialization/save_load.h"
 #include "eva/version.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace eva {
 
 Valuation evaluate(Program &program, const Valuation &inputs);
 
+// Evaluates a compiled program like evaluate, but adds the errors that CKKS
+// with the given encryption parameters is expected to introduce
+Valuation simulate(Program &program, const CKKSParameters &params,
+                   const Valuation &inputs, std::uint64_t seed = 0);
+
+// Sets the ranges of the outputs and the scales of the inputs and constants of
+// a program from bounds on the values of its inputs, so that the outputs are
+// precise to the given number of bits
+void setInputBounds(
+    Program &program,
+    const std::unordered_map<std::string, std::pair<double, double>> &bounds,
+    std::uint32_t precision);
+
 }
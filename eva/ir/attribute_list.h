@@ -13,6 +13,7 @@
 #include <memory>
 #include <utility>
 #include <variant>
+#include <vector>
 
 namespace eva {
 
@@ -46,10 +47,15 @@ public:
   AttributeList() : key(0), tail(nullptr) {}
 
   // This function is defined in eva/serialization/eva_serialization.cpp
-  void loadAttribute(const msg::Attribute &msg);
+  void loadAttribute(
+      const msg::Attribute &msg,
+      const std::vector<std::shared_ptr<ConstantValue>> &constants);
 
   // This function is defined in eva/serialization/eva_serialization.cpp
-  void serializeAttributes(std::function<msg::Attribute *()> addMsg) const;
+  void serializeAttributes(
+      std::function<msg::Attribute *()> addMsg,
+      std::function<std::uint32_t(const std::shared_ptr<ConstantValue> &)>
+          addConstant) const;
 
   template <class TAttr> bool has() const { return has(TAttr::key); }
 
@@ -16,7 +16,9 @@ namespace eva {
   X(TypeAttribute, Type)                                                       \
   X(RangeAttribute, std::uint32_t)                                             \
   X(EncodeAtScaleAttribute, std::uint32_t)                                     \
-  X(EncodeAtLevelAttribute, std::uint32_t)
+  X(EncodeAtLevelAttribute, std::uint32_t)                                     \
+  X(ReduceStrideAttribute, std::uint32_t)                                      \
+  X(ReduceCountAttribute, std::uint32_t)
 
 namespace detail {
 enum AttributeIndex {
@@ -4,6 +4,7 @@
 #pragma once
 
 #include "eva/serialization/eva.pb.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -80,6 +81,12 @@ public:
   void serialize(msg::ConstantValue &msg) const override {
     msg.set_size(size);
     auto valuesMsg = msg.mutable_values();
+    // A vector of all equal values is saved as a single broadcasted value
+    if (std::all_of(values.begin(), values.end(),
+                    [&](double value) { return value == values.front(); })) {
+      valuesMsg->Add(values.front());
+      return;
+    }
     valuesMsg->Reserve(values.size());
     for (const auto &value : values) {
       valuesMsg->Add(value);
@@ -102,7 +109,7 @@ public:
     scratch.clear();
     scratch.resize(slots);
     for (auto &entry : values) {
-      for (int i = 0; i < slots; i += values.size()) {
+      for (std::size_t i = 0; i < slots; i += size) {
         scratch.at(entry.first + i) = entry.second;
       }
     }
@@ -114,7 +121,7 @@ public:
     result.clear();
     result.resize(slots);
     for (auto &entry : values) {
-      for (int i = 0; i < slots; i += values.size()) {
+      for (std::size_t i = 0; i < slots; i += size) {
         result.at(entry.first + i) = entry.second;
       }
     }
@@ -19,6 +19,9 @@ namespace eva {
   X(Mul, 13)                                                                   \
   X(RotateLeftConst, 14)                                                       \
   X(RotateRightConst, 15)                                                      \
+  X(Polynomial, 16)                                                            \
+  X(MatVec, 17)                                                                \
+  X(Reduce, 18)                                                                \
   X(Relinearize, 20)                                                           \
   X(ModSwitch, 21)                                                             \
   X(Rescale, 22)                                                               \
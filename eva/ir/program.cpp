@@ -3,6 +3,7 @@
 
 #include "eva/ir/program.h"
 #include "eva/common/program_traversal.h"
+#include "eva/ir/program_observer.h"
 #include "eva/ir/term_map.h"
 #include "eva/util/logging.h"
 #include <stack>
@@ -74,6 +75,45 @@ void Program::unregisterTermMap(TermMapBase *termMap) {
   }
 }
 
+void Program::registerObserver(ProgramObserver *observer) {
+  observers.emplace_back(observer);
+}
+
+void Program::unregisterObserver(ProgramObserver *observer) {
+  auto iter = find(observers.begin(), observers.end(), observer);
+  if (iter == observers.end()) {
+    throw runtime_error("ProgramObserver to unregister not found");
+  } else {
+    observers.erase(iter);
+  }
+}
+
+void Program::notifyOperandsChanged(Term &term) {
+  for (ProgramObserver *observer : observers) {
+    observer->operandsChanged(term);
+  }
+}
+
+void Program::addSource(Term *term) {
+  sources.insert(term);
+  for (ProgramObserver *observer : observers) {
+    observer->sourceAdded(*term);
+  }
+}
+
+void Program::addSink(Term *term) {
+  sinks.insert(term);
+  for (ProgramObserver *observer : observers) {
+    observer->sinkAdded(*term);
+  }
+}
+
+void Program::notifyTermDestroyed(Term &term) {
+  for (ProgramObserver *observer : observers) {
+    observer->termDestroyed(term);
+  }
+}
+
 template <class Attr>
 void dumpAttribute(stringstream &s, Term *term, std::string label) {
   if (term->has<Attr>()) {
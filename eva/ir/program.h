@@ -20,6 +20,7 @@ namespace eva {
 template <typename> class TermMapOptional;
 template <typename> class TermMap;
 class TermMapBase;
+class ProgramObserver;
 
 class Program {
 public:
@@ -84,6 +85,16 @@ public:
     return rotation;
   }
 
+  // Sums up count elements that are stride apart, i.e., the result is
+  // term + (term << stride) + ... + (term << (count - 1) * stride)
+  Term::Ptr makeReduction(const Term::Ptr &term, std::uint32_t stride,
+                          std::uint32_t count) {
+    auto reduction = makeTerm(Op::Reduce, {term});
+    reduction->set<ReduceStrideAttribute>(stride);
+    reduction->set<ReduceCountAttribute>(count);
+    return reduction;
+  }
+
   Term::Ptr makeRescale(const Term::Ptr &term, std::uint32_t rescaleBy) {
     auto rescale = makeTerm(Op::Rescale, {term});
     rescale->set<RescaleDivisorAttribute>(rescaleBy);
@@ -125,6 +136,12 @@ private:
   void initTermMap(TermMapBase &termMap);
   void registerTermMap(TermMapBase *annotation);
   void unregisterTermMap(TermMapBase *annotation);
+  void registerObserver(ProgramObserver *observer);
+  void unregisterObserver(ProgramObserver *observer);
+  void notifyOperandsChanged(Term &term);
+  void addSource(Term *term);
+  void addSink(Term *term);
+  void notifyTermDestroyed(Term &term);
 
   std::string name;
   std::uint32_t vecSize;
@@ -135,6 +152,7 @@ private:
 
   std::uint64_t nextTermIndex;
   std::vector<TermMapBase *> termMaps;
+  std::vector<ProgramObserver *> observers;
 
   // These members must currently be last, because their destruction triggers
   // associated Terms to be destructed, which still use the sources and sinks
@@ -147,6 +165,7 @@ private:
 
   friend class Term;
   friend class TermMapBase;
+  friend class ProgramObserver;
   friend std::unique_ptr<msg::Program> serialize(const Program &);
   friend std::unique_ptr<Program> deserialize(const msg::Program &);
 };
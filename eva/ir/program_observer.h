@@ -0,0 +1,37 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "eva/ir/program.h"
+#include "eva/ir/term.h"
+
+namespace eva {
+
+/*
+Is notified of the changes made to a program for as long as it is alive.
+operandsChanged is called after the operands of a term are set, added, erased
+or replaced, which includes making a term with operands. sourceAdded and
+sinkAdded are called when a term joins the sources or sinks of the program,
+i.e., when it is made and when it loses its last operand or use. A term made
+with operands is briefly a source before its operands are set. termDestroyed is
+called before a term is destroyed. Observers must not modify the program in the
+notifications.
+*/
+class ProgramObserver {
+public:
+  ProgramObserver(Program &p) : program(&p) { program->registerObserver(this); }
+  virtual ~ProgramObserver() { program->unregisterObserver(this); }
+  ProgramObserver(const ProgramObserver &other) = delete;
+  ProgramObserver &operator=(const ProgramObserver &other) = delete;
+
+  virtual void operandsChanged(Term &term) {}
+  virtual void sourceAdded(Term &term) {}
+  virtual void sinkAdded(Term &term) {}
+  virtual void termDestroyed(Term &term) {}
+
+private:
+  Program *program;
+};
+
+} // namespace eva
@@ -12,11 +12,12 @@ namespace eva {
 
 Term::Term(Op op, Program &program)
     : op(op), program(program), index(program.allocateIndex()) {
-  program.sources.insert(this);
-  program.sinks.insert(this);
+  program.addSource(this);
+  program.addSink(this);
 }
 
 Term::~Term() {
+  program.notifyTermDestroyed(*this);
   for (Ptr &operand : operands) {
     operand->eraseUse(this);
   }
@@ -33,6 +34,7 @@ void Term::addOperand(const Term::Ptr &term) {
   }
   operands.emplace_back(term);
   term->addUse(this);
+  program.notifyOperandsChanged(*this);
 }
 
 bool Term::eraseOperand(const Ptr &term) {
@@ -41,8 +43,9 @@ bool Term::eraseOperand(const Ptr &term) {
     term->eraseUse(this);
     operands.erase(iter);
     if (operands.empty()) {
-      program.sources.insert(this);
+      program.addSource(this);
     }
+    program.notifyOperandsChanged(*this);
     return true;
   }
   return false;
@@ -58,6 +61,9 @@ bool Term::replaceOperand(Ptr oldTerm, Ptr newTerm) {
       replaced = true;
     }
   }
+  if (replaced) {
+    program.notifyOperandsChanged(*this);
+  }
   return replaced;
 }
 
@@ -93,8 +99,9 @@ void Term::setOperands(vector<Term::Ptr> o) {
   }
 
   if (operands.empty()) {
-    program.sources.insert(this);
+    program.addSource(this);
   }
+  program.notifyOperandsChanged(*this);
 }
 
 size_t Term::numOperands() const { return operands.size(); }
@@ -129,7 +136,7 @@ bool Term::eraseUse(Term *term) {
   assert(iter != uses.end());
   uses.erase(iter);
   if (uses.empty()) {
-    program.sinks.insert(this);
+    program.addSink(this);
     return true;
   }
   return false;
@@ -114,6 +114,10 @@ public:
 
   bool has(const Term::Ptr &term) const { return has(*term); }
 
+  void erase(const Term &term) { values.at(getIndex(term)).reset(); }
+
+  void erase(const Term::Ptr &term) { erase(*term); }
+
   void clear() { values.assign(values.size(), std::nullopt); }
 
 private:
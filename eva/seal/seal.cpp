@@ -4,10 +4,15 @@
 #include "eva/seal/seal.h"
 #include "eva/common/program_traversal.h"
 #include "eva/common/valuation.h"
+#include "eva/common/vector_tiler.h"
 #include "eva/seal/seal_executor.h"
 #include "eva/util/logging.h"
+#include <algorithm>
+#include <chrono>
+#include <complex>
 #include <cstddef>
 #include <cstdint>
+#include <random>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -23,6 +28,33 @@ namespace eva {
 
 SEALValuation SEALPublic::encrypt(const Valuation &inputs,
                                   const CKKSSignature &signature) {
+  // Split the inputs of tiled programs into their tiles and encrypt these
+  if (signature.tiles > 1) {
+    size_t vecSize = signature.vecSize;
+    Valuation tiledInputs;
+    for (auto &in : inputs) {
+      // Scalars are broadcast to every element of every tile
+      if (in.second.size() == 1) {
+        for (int i = 0; i < signature.tiles; ++i) {
+          tiledInputs[getTileName(in.first, i)] =
+              vector<double>(vecSize, in.second[0]);
+        }
+        continue;
+      }
+      if (in.second.size() != vecSize * signature.tiles) {
+        throw runtime_error("Input size does not match program vector size");
+      }
+      for (int i = 0; i < signature.tiles; ++i) {
+        auto begin = in.second.begin() + i * vecSize;
+        tiledInputs[getTileName(in.first, i)] =
+            vector<double>(begin, begin + vecSize);
+      }
+    }
+    return encrypt(tiledInputs,
+                   CKKSSignature(signature.vecSize, signature.inputs,
+                                 signature.unusedInputs));
+  }
+
   size_t slotCount = encoder.slot_count();
   if (slotCount < signature.vecSize) {
     throw runtime_error("Vector size cannot be larger than slot count");
@@ -50,11 +82,16 @@ SEALValuation SEALPublic::encrypt(const Valuation &inputs,
         auto name = in.first;
         auto &v = in.second;
         auto vSize = v.size();
-        // TODO remove this check
-        if (vSize != signature.vecSize) {
+        auto info = signature.inputs.at(name);
+        // Inputs of packed programs may hold up to one vector per instance
+        bool packed = (signature.instances > 1 || signature.complexPacked) &&
+                      info.inputType != Type::Raw;
+        size_t partSize = signature.vecSize * signature.instances;
+        size_t capacity = partSize * (signature.complexPacked ? 2 : 1);
+        if (vSize != signature.vecSize &&
+            !(packed && vSize % signature.vecSize == 0 && vSize <= capacity)) {
           throw runtime_error("Input size does not match program vector size");
         }
-        auto info = signature.inputs.at(name);
 
         auto ctxData = context.first_context_data();
         for (size_t i = 0; i < info.level; ++i) {
@@ -64,9 +101,35 @@ SEALValuation SEALPublic::encrypt(const Valuation &inputs,
         if (info.inputType == Type::Cipher || info.inputType == Type::Plain) {
           seal::Plaintext plain;
 
-          if (vSize == 1) {
+          if (vSize == 1 && signature.complexPacked) {
+            // A scalar is the same for all instances, including those in the
+            // imaginary parts
+            encoder.encode(complex<double>(v[0], v[0]), ctxData->parms_id(),
+                           pow(2.0, info.scale), plain);
+          } else if (vSize == 1) {
             encoder.encode(v[0], ctxData->parms_id(), pow(2.0, info.scale),
                            plain);
+          } else if (signature.complexPacked) {
+            // Instances that do not fit into the real parts go into the
+            // imaginary parts, and both are replicated to fill the slots
+            vector<complex<double>> vec(slotCount);
+            for (size_t r = 0; r < slotCount; r += partSize) {
+              for (size_t i = 0; i < vSize; ++i) {
+                if (i < partSize) {
+                  vec[r + i].real(v[i]);
+                } else {
+                  vec[r + i - partSize].imag(v[i]);
+                }
+              }
+            }
+            encoder.encode(vec, ctxData->parms_id(), pow(2.0, info.scale),
+                           plain);
+          } else if (packed) {
+            // Slots of instances that are not given are left as zero
+            vector<double> vec(slotCount);
+            copy(v.begin(), v.end(), vec.begin());
+            encoder.encode(vec, ctxData->parms_id(), pow(2.0, info.scale),
+                           plain);
           } else {
             vector<double> vec(slotCount);
             assert(vSize <= slotCount);
@@ -125,22 +188,53 @@ Valuation SEALSecret::decrypt(const SEALValuation &encOutputs,
                               const CKKSSignature &signature) {
   Valuation outputs;
   std::vector<double> tempVec;
+  std::vector<complex<double>> complexVec;
+  // Outputs of packed programs hold the results of all instances
+  size_t partSize = signature.vecSize * signature.instances;
+  size_t outputSize = partSize * (signature.complexPacked ? 2 : 1);
+  auto decode = [&](const seal::Plaintext &plain, vector<double> &output) {
+    if (!signature.complexPacked) {
+      encoder.decode(plain, output);
+      return;
+    }
+    // The instances in the imaginary parts follow those in the real parts
+    encoder.decode(plain, complexVec);
+    output.resize(outputSize);
+    for (size_t i = 0; i < partSize; ++i) {
+      output[i] = complexVec[i].real();
+      output[partSize + i] = complexVec[i].imag();
+    }
+  };
   for (auto &out : encOutputs) {
     auto name = out.first;
     visit(Overloaded{[&](const seal::Ciphertext &cipher) {
                        seal::Plaintext plain;
                        decryptor.decrypt(cipher, plain);
-                       encoder.decode(plain, outputs[name]);
+                       decode(plain, outputs[name]);
                      },
                      [&](const seal::Plaintext &plain) {
-                       encoder.decode(plain, outputs[name]);
+                       decode(plain, outputs[name]);
                      },
                      [&](const std::shared_ptr<ConstantValue> &raw) {
                        auto &scratch = tempVec;
-                       outputs[name] = raw->expand(scratch, signature.vecSize);
+                       outputs[name] = raw->expand(scratch, outputSize);
                      }},
           out.second);
-    outputs.at(name).resize(signature.vecSize);
+    outputs.at(name).resize(outputSize);
+  }
+
+  // Concatenate the tiles of the outputs of tiled programs
+  if (signature.tiles > 1) {
+    size_t vecSize = signature.vecSize;
+    Valuation untiledOutputs;
+    for (auto &out : outputs) {
+      auto [name, tile] = splitTileName(out.first);
+      auto &values = untiledOutputs[name];
+      values.resize(vecSize * signature.tiles);
+      copy(out.second.begin(), out.second.end(),
+           values.begin() + tile * vecSize);
+    }
+    return untiledOutputs;
   }
   return outputs;
 }
@@ -202,4 +296,28 @@ generateKeys(const CKKSParameters &abstractParams) {
   return make_tuple(move(publicCtx), move(secretCtx));
 }
 
+double measureExecution(Program &program, const CKKSParameters &abstractParams,
+                        const CKKSSignature &signature) {
+  auto [publicCtx, secretCtx] = generateKeys(abstractParams);
+
+  // The inputs of the compiled program are already split into tiles
+  mt19937 random(0);
+  uniform_real_distribution<double> distribution(-1, 1);
+  Valuation inputs;
+  for (auto &entry : program.getInputs()) {
+    auto &values = inputs[entry.first];
+    values.resize(signature.vecSize);
+    for (auto &value : values) {
+      value = distribution(random);
+    }
+  }
+  auto encInputs = publicCtx->encrypt(
+      inputs, CKKSSignature(signature.vecSize, signature.inputs,
+                            signature.unusedInputs));
+
+  auto start = chrono::steady_clock::now();
+  publicCtx->execute(program, encInputs);
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
 } // namespace eva
@@ -96,4 +96,9 @@ seal::SEALContext getSEALContext(const seal::EncryptionParameters &params);
 std::tuple<std::unique_ptr<SEALPublic>, std::unique_ptr<SEALSecret>>
 generateKeys(const CKKSParameters &abstractParams);
 
+// Times one execution of a compiled program on random encrypted inputs and
+// returns the seconds it took. Key generation and encryption are not timed.
+double measureExecution(Program &program, const CKKSParameters &abstractParams,
+                        const CKKSSignature &signature);
+
 } // namespace eva
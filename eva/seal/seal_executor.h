@@ -9,6 +9,7 @@
 #include "eva/util/logging.h"
 #include "eva/util/overloaded.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -40,6 +41,9 @@ class SEALExecutor {
   seal::GaloisKeys &galoisKeys;
   seal::RelinKeys &relinKeys;
   TermMapOptional<RuntimeValue> Objects;
+  // Counts the requests to free the source of collapsed ModSwitch chains and
+  // the chains that are done with it. The source is freed once both are done.
+  TermMap<std::atomic_uint32_t> sourceReleases;
 
   // Each thread has a separate scratch space into which constants are expanded
   // for encoding.
@@ -178,6 +182,9 @@ class SEALExecutor {
                   std::int32_t rotation) {
     assert(isCipher(args1));
     seal::Ciphertext &input1 = std::get<seal::Ciphertext>(Objects.at(args1));
+    // TODO: hoist rotations of the same ciphertext by distinct steps, so that
+    // they share one decomposition of it for key switching. This needs the key
+    // switching internals of SEAL, which its Evaluator does not expose.
     evaluator.rotate_vector(input1, rotation, galoisKeys, output);
   }
 
@@ -200,10 +207,58 @@ class SEALExecutor {
     evaluator.relinearize(input1, relinKeys, output);
   }
 
-  void modSwitch(seal::Ciphertext &output, const Term::Ptr &args1) {
-    assert(isCipher(args1));
-    seal::Ciphertext &input1 = std::get<seal::Ciphertext>(Objects.at(args1));
-    evaluator.mod_switch_to_next(input1, output);
+  // A ModSwitch whose only use is another ModSwitch is not executed on its
+  // own. The last ModSwitch of such a chain switches all the way at once.
+  bool isCollapsedModSwitch(const Term::Ptr &term) {
+    if (term->op != Op::ModSwitch || term->numUses() != 1) return false;
+    return term->getUses()[0]->op == Op::ModSwitch;
+  }
+
+  std::size_t countCollapsedModSwitchUses(const Term::Ptr &term) {
+    std::size_t count = 0;
+    for (auto &use : term->getUses()) {
+      if (isCollapsedModSwitch(use)) ++count;
+    }
+    return count;
+  }
+
+  // Called once when the traversal frees the source of collapsed chains and
+  // once when each of these chains has been executed. Only the last of these
+  // calls frees the value, which may happen on any thread.
+  void releaseChainSource(const Term::Ptr &source) {
+    if (++sourceReleases[source] == countCollapsedModSwitchUses(source) + 1) {
+      release(source);
+    }
+  }
+
+  void release(const Term::Ptr &term) {
+    auto &obj = Objects.at(term);
+    std::visit(Overloaded{[](seal::Ciphertext &cipher) { cipher.release(); },
+                          [](seal::Plaintext &plain) { plain.release(); },
+                          [](std::vector<double> &raw) {
+                            raw.clear();
+                            raw.shrink_to_fit();
+                          }},
+               obj);
+  }
+
+  void modSwitch(seal::Ciphertext &output, const Term::Ptr &term) {
+    auto source = term->operandAt(0);
+    std::size_t steps = 1;
+    while (isCollapsedModSwitch(source)) {
+      source = source->operandAt(0);
+      ++steps;
+    }
+    assert(isCipher(source));
+    seal::Ciphertext &input1 = std::get<seal::Ciphertext>(Objects.at(source));
+    auto contextData = context.get_context_data(input1.parms_id());
+    for (std::size_t i = 0; i < steps; ++i) {
+      contextData = contextData->next_context_data();
+    }
+    evaluator.mod_switch_to(input1, contextData->parms_id(), output);
+    if (steps > 1) {
+      releaseChainSource(source);
+    }
   }
 
   void rescale(seal::Ciphertext &output, const Term::Ptr &args1,
@@ -256,7 +311,7 @@ public:
                seal::Encryptor &enc, seal::Evaluator &e, seal::GaloisKeys &gk,
                seal::RelinKeys &rk)
       : program(g), context(ctx), encoder(ce), encryptor(enc), evaluator(e),
-        galoisKeys(gk), relinKeys(rk), Objects(g) {
+        galoisKeys(gk), relinKeys(rk), Objects(g), sourceReleases(g) {
     assert(program.getVecSize() <= encoder.slot_count());
     assert((encoder.slot_count() % program.getVecSize()) == 0);
   }
@@ -384,9 +439,9 @@ public:
     } break;
     case Op::ModSwitch: {
       assert(args.size() == 1);
-      assert(isCipher(args[0]));
+      if (isCollapsedModSwitch(term)) break;
       auto &output = initValue<seal::Ciphertext>(term);
-      modSwitch(output, args[0]);
+      modSwitch(output, term);
     } break;
     case Op::Rescale: {
       assert(args.size() == 1);
@@ -404,17 +459,15 @@ public:
   }
 
   void free(const Term::Ptr &term) {
-    if (term->op == Op::Output) {
+    if (term->op == Op::Output || isCollapsedModSwitch(term)) {
       return;
     }
-    auto &obj = Objects.at(term);
-    std::visit(Overloaded{[](seal::Ciphertext &cipher) { cipher.release(); },
-                          [](seal::Plaintext &plain) { plain.release(); },
-                          [](std::vector<double> &raw) {
-                            raw.clear();
-                            raw.shrink_to_fit();
-                          }},
-               obj);
+    // The ends of collapsed chains may still need the value
+    if (countCollapsedModSwitchUses(term) > 0) {
+      releaseChainSource(term);
+      return;
+    }
+    release(term);
   }
 
   void getOutputs(SEALValuation &encOutputs) {
@@ -5,6 +5,7 @@
 #include "eva/ckks/ckks_signature.h"
 #include "eva/serialization/ckks.pb.h"
 #include <memory>
+#include <set>
 #include <utility>
 
 using namespace std;
@@ -63,6 +64,16 @@ unique_ptr<msg::CKKSSignature> serialize(const CKKSSignature &obj) {
     infoMsg.set_level(info.level);
   }
 
+  // Save the unused inputs
+  for (auto &name : obj.unusedInputs) {
+    msg->add_unused_inputs(name);
+  }
+
+  // Save the number of tiles and packed instances
+  msg->set_tiles(obj.tiles);
+  msg->set_instances(obj.instances);
+  msg->set_complex_packed(obj.complexPacked);
+
   return msg;
 }
 
@@ -75,8 +86,17 @@ unique_ptr<CKKSSignature> deserialize(const msg::CKKSSignature &msg) {
                                     infoMsg.scale(), infoMsg.level()));
   }
 
+  set<string> unusedInputs(msg.unused_inputs().begin(),
+                           msg.unused_inputs().end());
+
+  // Signatures saved before tiling was supported have no tiles field
+  auto tiles = msg.tiles() == 0 ? 1 : msg.tiles();
+  auto instances = msg.instances() == 0 ? 1 : msg.instances();
+
   // Return a new CKKSSignature object
-  return make_unique<CKKSSignature>(msg.vec_size(), move(inputs));
+  return make_unique<CKKSSignature>(msg.vec_size(), move(inputs),
+                                    move(unusedInputs), tiles, instances,
+                                    msg.complex_packed());
 }
 
 } // namespace eva
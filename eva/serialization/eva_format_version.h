@@ -8,6 +8,6 @@
 namespace eva {
 
 // Bump the version for any changes that break serialization
-const std::int32_t EVA_FORMAT_VERSION = 2;
+const std::int32_t EVA_FORMAT_VERSION = 3;
 
 } // namespace eva
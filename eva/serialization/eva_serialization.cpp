@@ -6,12 +6,14 @@
 #include "eva/ir/term_map.h"
 #include "eva/serialization/eva_format_version.h"
 #include "eva/util/overloaded.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <stack>
 #include <stdexcept>
+#include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -23,7 +25,9 @@ namespace eva {
 // Definition for member function AttributeList::loadAttribute
 // The function definition is here so that all serialization code is together
 // and not spread out throughout the project
-void AttributeList::loadAttribute(const msg::Attribute &msg) {
+void AttributeList::loadAttribute(
+    const msg::Attribute &msg,
+    const vector<shared_ptr<ConstantValue>> &constants) {
   // Load the attribute key; this encodes the type of the attribute
   AttributeKey key = static_cast<AttributeKey>(msg.key());
 
@@ -47,6 +51,15 @@ void AttributeList::loadAttribute(const msg::Attribute &msg) {
     // The attribute holds a constant value; load it
     value.emplace<shared_ptr<ConstantValue>>(deserialize(msg.constant_value()));
     break;
+  case msg::Attribute::kConstantIndex:
+    // The attribute refers to a constant value in the constant pool of the
+    // program; share the already loaded value
+    if (msg.constant_index() >= constants.size()) {
+      throw runtime_error("Constant index out of range");
+    }
+    value.emplace<shared_ptr<ConstantValue>>(
+        constants.at(msg.constant_index()));
+    break;
   case msg::Attribute::VALUE_NOT_SET:
     // No value is set; set the attribute to std::monostate
     value.emplace<monostate>();
@@ -69,7 +82,8 @@ void AttributeList::loadAttribute(const msg::Attribute &msg) {
 // The function definition is here so that all serialization code is together
 // and not spread out throughout the project
 void AttributeList::serializeAttributes(
-    function<msg::Attribute *()> addMsg) const {
+    function<msg::Attribute *()> addMsg,
+    function<uint32_t(const shared_ptr<ConstantValue> &)> addConstant) const {
   // Nothing to do if key is zero (empty attribute; see eva/ir/attributes.h)
   if (key == 0) {
     return;
@@ -92,8 +106,9 @@ void AttributeList::serializeAttributes(
                        msg->set_type(static_cast<uint32_t>(value));
                      },
                      [&](const shared_ptr<ConstantValue> &value) {
-                       auto valueMsg = serialize(*value);
-                       msg->set_allocated_constant_value(valueMsg.release());
+                       // Constants are saved in a separate pool; only store
+                       // a reference here
+                       msg->set_constant_index(addConstant(value));
                      }},
           curr->value);
 
@@ -147,8 +162,9 @@ unique_ptr<msg::Program> serialize(const Program &obj) {
   // Create a new program message for serialization
   auto msg = make_unique<msg::Program>();
 
-  // Save the IR version and vector size
+  // Save the IR version, name and vector size
   msg->set_ir_version(EVA_FORMAT_VERSION);
+  msg->set_name(obj.name);
   msg->set_vec_size(obj.vecSize);
 
   // Save all terms in topologically sorted order; this is convenient so we can
@@ -161,6 +177,35 @@ unique_ptr<msg::Program> serialize(const Program &obj) {
   // Table of topological indices assigned to the terms
   unordered_map<Term *, uint64_t> indices;
 
+  // Constant values are saved only once in a pool in the program message and
+  // attributes refer to them by their index in the pool. Many terms may share
+  // the same ConstantValue object (e.g., after a deep copy), and distinct
+  // objects may still hold identical values (e.g., the same uniform constant
+  // written many times in the source program). The first table catches the
+  // former case cheaply and the second one deduplicates by the serialized
+  // bytes of the constant.
+  unordered_map<const ConstantValue *, uint32_t> constantIndices;
+  unordered_map<string, uint32_t> constantBytesIndices;
+  auto addConstant = [&](const shared_ptr<ConstantValue> &value) {
+    auto iter = constantIndices.find(value.get());
+    if (iter != constantIndices.end()) {
+      return iter->second;
+    }
+    auto valueMsg = serialize(*value);
+    auto bytes = valueMsg->SerializeAsString();
+    auto bytesIter = constantBytesIndices.find(bytes);
+    uint32_t index;
+    if (bytesIter != constantBytesIndices.end()) {
+      index = bytesIter->second;
+    } else {
+      index = msg->constants_size();
+      msg->mutable_constants()->AddAllocated(valueMsg.release());
+      constantBytesIndices.emplace(move(bytes), index);
+    }
+    constantIndices.emplace(value.get(), index);
+    return index;
+  };
+
   // Index to be assigned next
   uint64_t nextIndex = 0;
 
@@ -169,9 +214,33 @@ unique_ptr<msg::Program> serialize(const Program &obj) {
   // been processed. If this is false, we are ready to give the term an index.
   stack<pair<bool, Term *>> work;
 
-  // Add each sink to the work stack with visit flag set to true
+  // The inputs and outputs are kept in unordered maps and the sinks in a set
+  // ordered by address, so sort them by name to save equal programs the same
+  // way in every process
+  auto sortedByName = [](const unordered_map<string, Term::Ptr> &terms) {
+    vector<pair<string, Term *>> sorted;
+    for (const auto &entry : terms) {
+      sorted.emplace_back(entry.first, entry.second.get());
+    }
+    sort(sorted.begin(), sorted.end());
+    return sorted;
+  };
+  auto inputs = sortedByName(obj.inputs);
+  auto outputs = sortedByName(obj.outputs);
+
+  // Add each sink to the work stack with visit flag set to true, such that
+  // the outputs are processed first in order of their names, then the inputs
+  // and then any other sinks
   for (const auto &sink : obj.getSinks()) {
-    work.emplace(true, sink.get());
+    if (sink->op != Op::Output && sink->op != Op::Input) {
+      work.emplace(true, sink.get());
+    }
+  }
+  for (auto it = inputs.rbegin(); it != inputs.rend(); ++it) {
+    work.emplace(true, it->second);
+  }
+  for (auto it = outputs.rbegin(); it != outputs.rend(); ++it) {
+    work.emplace(true, it->second);
   }
 
   // Operate on the stack until empty
@@ -213,27 +282,30 @@ unique_ptr<msg::Program> serialize(const Program &obj) {
       auto termMsg = msg->add_terms();
       termMsg->set_op(static_cast<uint32_t>(term->op));
       for (const auto &operand : term->getOperands()) {
-        // Add operands to the current term by saving the indices
-        termMsg->add_operands(indices.at(operand.get()));
+        // Add operands to the current term by saving their distance to the
+        // current index; operands always have a smaller index so this is
+        // strictly positive
+        termMsg->add_operands(index - indices.at(operand.get()));
       }
 
       // Save the attributes for this term
-      term->serializeAttributes([&]() { return termMsg->add_attributes(); });
+      term->serializeAttributes([&]() { return termMsg->add_attributes(); },
+                                addConstant);
     }
   }
 
   // Save the input term indices and labels
-  for (const auto &entry : obj.inputs) {
+  for (const auto &entry : inputs) {
     auto termNameMsg = msg->add_inputs();
     termNameMsg->set_name(entry.first);
-    termNameMsg->set_term(indices.at(entry.second.get()));
+    termNameMsg->set_term(indices.at(entry.second));
   }
 
   // Save the output term indices and labels
-  for (const auto &entry : obj.outputs) {
+  for (const auto &entry : outputs) {
     auto termNameMsg = msg->add_outputs();
     termNameMsg->set_name(entry.first);
-    termNameMsg->set_term(indices.at(entry.second.get()));
+    termNameMsg->set_term(indices.at(entry.second));
   }
 
   return msg;
@@ -248,6 +320,14 @@ unique_ptr<Program> deserialize(const msg::Program &msg) {
   // Create a new program with the loaded name and vector size
   auto obj = make_unique<Program>(msg.name(), msg.vec_size());
 
+  // Load the constant pool; terms referring to the same pool entry will share
+  // a single ConstantValue object
+  vector<shared_ptr<ConstantValue>> constants;
+  constants.reserve(msg.constants_size());
+  for (auto &constant : msg.constants()) {
+    constants.emplace_back(deserialize(constant));
+  }
+
   // Create a vector of term pointers
   vector<Term::Ptr> terms;
 
@@ -263,15 +343,20 @@ unique_ptr<Program> deserialize(const msg::Program &msg) {
       throw runtime_error("Invalid op encountered");
     }
 
-    // Create a new term and set its operands (already loaded)
+    // Create a new term and set its operands (already loaded); the operands
+    // are saved as distances back from the index of the current term
+    auto index = terms.size();
     terms.emplace_back(obj->makeTerm(op));
-    for (auto &operandIdx : term.operands()) {
-      terms.back()->addOperand(terms.at(operandIdx));
+    for (auto &operandDist : term.operands()) {
+      if (operandDist == 0 || operandDist > index) {
+        throw runtime_error("Invalid operand encountered");
+      }
+      terms.back()->addOperand(terms.at(index - operandDist));
     }
 
     // Load attributes for this term
     for (auto &attribute : term.attributes()) {
-      terms.back()->loadAttribute(attribute);
+      terms.back()->loadAttribute(attribute, constants);
     }
   }
 
@@ -0,0 +1,42 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+namespace eva {
+
+// Incremental 64-bit FNV-1a hash. Unlike std::hash the result is fully
+// specified, so hashes can be persisted and compared between processes.
+class Hasher {
+public:
+  void update(const void *data, std::size_t size) {
+    auto bytes = static_cast<const unsigned char *>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+      state ^= bytes[i];
+      state *= 1099511628211ull;
+    }
+  }
+
+  template <class T> void update(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Only trivially copyable values can be hashed directly");
+    update(&value, sizeof(T));
+  }
+
+  void update(const std::string &str) {
+    update(str.size());
+    update(str.data(), str.size());
+  }
+
+  std::uint64_t digest() const { return state; }
+
+private:
+  std::uint64_t state = 14695981039346656037ull;
+};
+
+} // namespace eva
@@ -0,0 +1,86 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace eva {
+
+// Runs tasks on a fixed number of threads, so that submitting many tasks does
+// not start a thread for each of them. The destructor waits for all submitted
+// tasks to finish.
+class ThreadPool {
+public:
+  // One thread per hardware thread
+  ThreadPool() : ThreadPool(std::thread::hardware_concurrency()) {}
+
+  ThreadPool(std::size_t threadCount) {
+    threadCount = std::max<std::size_t>(threadCount, 1);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+      threads.emplace_back([this]() { work(); });
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    condition.notify_all();
+    for (auto &thread : threads) {
+      thread.join();
+    }
+  }
+
+  // Queues task to run on one of the threads. Exceptions thrown by the task
+  // are rethrown by get on the returned future.
+  template <class F> auto submit(F task) -> std::future<decltype(task())> {
+    // std::function must be copyable, so share the packaged task
+    auto packaged =
+        std::make_shared<std::packaged_task<decltype(task())()>>(
+            std::move(task));
+    auto future = packaged->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.emplace([packaged]() { (*packaged)(); });
+    }
+    condition.notify_one();
+    return future;
+  }
+
+private:
+  std::vector<std::thread> threads;
+  std::queue<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+        if (tasks.empty()) return;
+        task = std::move(tasks.front());
+        tasks.pop();
+      }
+      task();
+    }
+  }
+};
+
+} // namespace eva
@@ -1,21 +1,85 @@
 # Copyright (c) Microsoft Corporation. All rights reserved.
 # Licensed under the MIT license.
-from eva import py_to_eva
+from eva import py_to_eva, Expr, Op
 
-def horizontal_sum(x):
+def horizontal_sum(x, count=None, stride=1):
 	""" Sum together all elements of a vector. The result is replicated in all
 		elements of the returned vector.
+
+		With count and stride, element i of the result is instead the sum of
+		the count elements i, i + stride, ..., i + (count - 1) * stride, with
+		indices wrapping around. For example, for a vector holding a matrix
+		row by row, stride=1 and count=width sums up the rows and stride=width
+		and count=height sums up the columns. The compiler chooses how to
+		rotate based on the rotations used elsewhere in the program.
 	
 		Parameters
 		----------
 		x : an EVA compatible type (see eva.py_to_eva)
 			The vector to sum together
+		count : int, optional
+			How many elements to sum together. Defaults to the vector size.
+		stride : int, optional
+			The distance between the summed elements. Defaults to 1.
+		"""
+
+	x = py_to_eva(x)
+	if count is None:
+		count = x.program.vec_size
+	if count < 1 or stride < 0:
+		raise ValueError("count must be positive and stride non-negative")
+	return Expr(x.program._make_reduction(x.term, stride, count), x.program)
+
+def polynomial(x, coefficients):
+	""" Evaluate a polynomial elementwise. The compiler evaluates the polynomial
+		with a baby-step giant-step method that uses far fewer multiplications
+		and levels than computing each power separately.
+
+		Parameters
+		----------
+		x : an EVA compatible type (see eva.py_to_eva)
+			The vector to evaluate the polynomial at
+		coefficients : list of EVA compatible types
+			The coefficients starting from the constant term, i.e.,
+			coefficients[i] is multiplied with x**i
 		"""
 
 	x = py_to_eva(x)
-	i = 1
-	while i < x.program.vec_size:
-		y = x << i
-		x = x + y
-		i <<= 1
-	return x
+	if len(coefficients) == 0:
+		raise ValueError("polynomial requires at least one coefficient")
+	terms = [x.term] + [py_to_eva(c, x.program).term for c in coefficients]
+	return Expr(x.program._make_term(Op.Polynomial, terms), x.program)
+
+def matvec(matrix, x):
+	""" Multiply a matrix with a vector. The compiler uses the diagonal method
+		with baby-step giant-step rotations, which needs a number of rotations
+		proportional to the square root of the vector size.
+
+		Parameters
+		----------
+		matrix : list of lists of numbers
+			The rows of the matrix. Must have at most vector size many rows and
+			columns. Missing entries are treated as zeros.
+		x : an EVA compatible type (see eva.py_to_eva)
+			The vector to multiply
+		"""
+
+	x = py_to_eva(x)
+	n = x.program.vec_size
+	if len(matrix) > n or any(len(row) > n for row in matrix):
+		raise ValueError("matrix must have at most vector size many rows and columns")
+
+	def entry(i, j):
+		if i < len(matrix) and j < len(matrix[i]):
+			return matrix[i][j]
+		return 0
+
+	# The i-th generalized diagonal holds the entries (j, j+i) for all rows j
+	terms = [x.term]
+	for i in range(n):
+		diagonal = [entry(j, (j + i) % n) for j in range(n)]
+		if all(value == 0 for value in diagonal):
+			terms.append(py_to_eva(0, x.program).term)
+		else:
+			terms.append(py_to_eva(diagonal, x.program).term)
+	return Expr(x.program._make_term(Op.MatVec, terms), x.program)
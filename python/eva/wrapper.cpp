@@ -62,6 +62,21 @@ Parameters
 ----------
 range : int
     The range in bits. Must be positive.)DELIMITER", py::arg("range"))
+    .def("set_input_bounds", &setInputBounds, R"DELIMITER(Sets the ranges of outputs and the scales of inputs and constants from
+bounds on the values of the inputs. Replaces both set_output_ranges and
+set_input_scales.
+
+The bounds on the outputs are found with interval arithmetic. The scales are
+chosen so that the errors from encoding inputs and constants, amplified by the
+computation, stay below 2^-precision in the outputs. Encryption adds errors of
+its own, so a few more bits may be needed in practice.
+
+Parameters
+----------
+bounds : dict from strings to pairs of floats
+    The lowest and highest value of each input
+precision : int
+    The number of bits after the binary point the outputs must be precise to)DELIMITER", py::arg("bounds"), py::arg("precision"))
     .def("set_input_scales", [](const Program& prog, uint32_t scale) {
       for (auto& source : prog.getSources()) {
         source->set<EncodeAtScaleAttribute>(scale);
@@ -83,6 +98,7 @@ str
     .def("_make_term", &Program::makeTerm, py::keep_alive<0,1>())
     .def("_make_left_rotation", &Program::makeLeftRotation, py::keep_alive<0,1>())
     .def("_make_right_rotation", &Program::makeRightRotation, py::keep_alive<0,1>())
+    .def("_make_reduction", &Program::makeReduction, py::keep_alive<0,1>())
     .def("_make_dense_constant", &Program::makeDenseConstant, py::keep_alive<0,1>())
     .def("_make_uniform_constant", &Program::makeUniformConstant, py::keep_alive<0,1>())
     .def("_make_input", &Program::makeInput, py::keep_alive<0,1>())
@@ -105,6 +121,29 @@ Returns
 -------
 dict from strings to lists of numbers
     The outputs from the evaluation)DELIMITER", py::arg("program"), py::arg("inputs"));
+  m.def("simulate", &simulate, R"DELIMITER(Evaluate a compiled program without encryption, simulating the errors of CKKS
+
+Adds to each value the error that encoding, encryption, rescaling,
+relinearization and rotations with the selected encryption parameters are
+expected to introduce. Comparing the outputs with those of evaluate, for example
+with valuation_mse, predicts the precision of the encrypted computation, which
+helps in choosing input scales and output ranges without generating keys.
+
+Parameters
+----------
+program : Program
+    The compiled program to be evaluated
+params : CKKSParameters
+    The encryption parameters selected by the compiler
+inputs : dict from strings to lists of numbers
+    The inputs for the evaluation
+seed : int, optional
+    The seed for the simulated errors
+
+Returns
+-------
+dict from strings to lists of numbers
+    The outputs from the evaluation)DELIMITER", py::arg("program"), py::arg("params"), py::arg("inputs"), py::arg("seed") = 0);
   
   // Serialization
   m.def("save", &saveToFile<Program>, SAVE_DOC_STRING, py::arg("obj"), py::arg("path"));
@@ -166,14 +205,55 @@ Program
 CKKSParameters
     The selected encryption parameters
 CKKSSignature
-    The signature of the program)DELIMITER", py::arg("program"));
+    The signature of the program)DELIMITER", py::arg("program"))
+    .def("autotune", [](CKKSCompiler &compiler, Program &program, py::object measure) {
+      CKKSCompiler::MeasureFunction measureFunction;
+      if (!measure.is_none()) {
+        measureFunction = [measure](Program &compiled, const CKKSParameters &params, const CKKSSignature &signature) {
+          auto policy = py::return_value_policy::reference;
+          return measure(py::cast(&compiled, policy), py::cast(&params, policy), py::cast(&signature, policy)).cast<double>();
+        };
+      }
+      return compiler.autotune(program, measureFunction);
+    }, R"DELIMITER(Compile a program for CKKS with every combination of the rescaler, relinearizer and balance_reductions options and pick the cheapest
+
+Parameters
+----------
+program : Program
+    The program to compile
+measure : callable, optional
+    Called with each compiled program, CKKSParameters and CKKSSignature to
+    measure its cost, such as eva.seal.measure_execution. By default the cost
+    is estimated by the compiler.
+
+Returns
+-------
+Program
+    The compiled program with the lowest cost
+CKKSParameters
+    The selected encryption parameters
+CKKSSignature
+    The signature of the program
+list of CKKSAutotuneResult
+    The results for all combinations, cheapest first)DELIMITER", py::arg("program"), py::arg("measure") = py::none());
+  py::class_<CKKSAutotuneResult>(mckks, "CKKSAutotuneResult", "The result of compiling with one of the configurations tried by autotune")
+    .def_readonly("options", &CKKSAutotuneResult::options, "The options that were varied, which can be passed to CKKSCompiler")
+    .def_readonly("cost", &CKKSAutotuneResult::cost, "The estimated cost, or the measured cost if measured is true")
+    .def_readonly("measured", &CKKSAutotuneResult::measured, "Whether the cost was measured instead of estimated")
+    .def_readonly("poly_modulus_degree", &CKKSAutotuneResult::polyModulusDegree, "The polynomial degree N required")
+    .def_readonly("prime_count", &CKKSAutotuneResult::primeCount, "The number of primes required")
+    .def_readonly("error", &CKKSAutotuneResult::error, "Why the compilation failed, or empty if it succeeded");
   py::class_<CKKSParameters>(mckks, "CKKSParameters", "Abstract encryption parameters for CKKS")
     .def_readonly("prime_bits", &CKKSParameters::primeBits, "List of number of bits each prime should have")
     .def_readonly("rotations", &CKKSParameters::rotations, "List of steps that rotation keys should be generated for")
     .def_readonly("poly_modulus_degree", &CKKSParameters::polyModulusDegree, "The polynomial degree N required");
   py::class_<CKKSSignature>(mckks, "CKKSSignature", "The signature of a compiled program used for encoding and decoding")
     .def_readonly("vec_size", &CKKSSignature::vecSize, "The vector size of the program")
-    .def_readonly("inputs", &CKKSSignature::inputs, "Dictionary of CKKSEncodingInfo objects for each input");
+    .def_readonly("inputs", &CKKSSignature::inputs, "Dictionary of CKKSEncodingInfo objects for each input")
+    .def_readonly("unused_inputs", &CKKSSignature::unusedInputs, "Set of names of inputs that no output depends on and that need not be encrypted")
+    .def_readonly("tiles", &CKKSSignature::tiles, "The number of tiles of vec_size elements that each input and output is split into")
+    .def_readonly("instances", &CKKSSignature::instances, "The number of independent instances of vec_size elements packed into each input and output")
+    .def_readonly("complex_packed", &CKKSSignature::complexPacked, "Whether the imaginary parts of the slots hold as many instances again, which follow the others in each input and output");
   py::class_<CKKSEncodingInfo>(mckks, "CKKSEncodingInfo", "Holds the information required for encoding an input")
     .def_readonly("input_type", &CKKSEncodingInfo::inputType, "The type of this input. Decides whether input is encoded, also encrypted or neither.")
     .def_readonly("scale", &CKKSEncodingInfo::scale, "The scale encoding should happen at")
@@ -197,6 +277,24 @@ SEALSecret
     WARNING: This object holds your generated secret key. Do not share this object
               (or its serialized form) with anyone you do not want having access
               to the values encrypted with the public context.)DELIMITER", py::arg("absract_params"));
+  mseal.def("measure_execution", &measureExecution, R"DELIMITER(Time one execution of a compiled program with SEAL on random inputs
+
+Can be passed to CKKSCompiler.autotune to pick the configuration that runs
+fastest. Key generation and encryption are not timed.
+
+Parameters
+----------
+program : Program
+    The compiled program
+abstract_params : CKKSParameters
+    Specification of the encryption parameters from the compiler
+signature : CKKSSignature
+    The signature of the program
+
+Returns
+-------
+float
+    The seconds the execution took)DELIMITER", py::arg("program"), py::arg("abstract_params"), py::arg("signature"));
   py::class_<SEALValuation>(mseal, "SEALValuation", "A valuation for inputs or outputs holding values encrypted with SEAL");
   py::class_<SEALPublic>(mseal, "SEALPublic", "The public part of the SEAL context that is used for encryption and execution.")
     .def("encrypt", &SEALPublic::encrypt, R"DELIMITER(Encrypt inputs for a compiled EVA program
@@ -204,7 +302,8 @@ SEALSecret
 Parameters
 ----------
 inputs : dict from strings to lists of numbers
-    The values to be encrypted
+    The values to be encrypted. For tiled programs, a list holding a single
+    number is broadcast to all elements of the vector.
 signature : CKKSSignature
     The signature of the program the inputs are being encrypted for
 
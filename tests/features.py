@@ -4,8 +4,13 @@
 import unittest
 import tempfile
 import os
+import math
+import subprocess
+import sys
 from common import *
-from eva import EvaProgram, Input, Output, save, load
+from eva import EvaProgram, Input, Output, save, load, simulate, py_to_eva
+from eva.seal import measure_execution
+from eva.std.numeric import horizontal_sum
 
 class Features(EvaTestCase):
     def test_bin_ops(self):
@@ -132,6 +137,120 @@ class Features(EvaTestCase):
             config={'rescaler':'always', 'balance_reductions':'true', 'warn_vec_size':'false'})
         self.assertEqual(params.prime_bits, [60, 20, 60, 60, 60])
 
+    def test_depth_aware_balancing(self):
+        """ Check that shallow factors are multiplied together before deep ones """
+
+        prog = EvaProgram('DepthAwareBalancing', vec_size=64)
+        with prog:
+            a = Input('a')
+            b = Input('b')
+            c = Input('c')
+            x = Input('x')
+            y = Input('y')
+            z = Input('z')
+            deep = x*y*z
+            Output('deep', deep)
+            Output('product', a*(b*(deep*c)))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        # Multiplying a and b first and then with c keeps the product at the
+        # depth of deep plus one
+        progc, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'rescaler':'always', 'balance_reductions':'true', 'warn_vec_size':'false'})
+        self.assertEqual(params.prime_bits, [50, 30, 30, 30, 50])
+
+    def test_mod_switch_chains(self):
+        """ Test that an input dropped several levels at once computes correctly """
+
+        prog = EvaProgram('ModSwitchChains', vec_size=64)
+        with prog:
+            x = Input('x')
+            Output('deep', x**8)
+            Output('shallow', x + (x<<1))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        self.assert_compiles_and_matches_reference(prog,
+            config={'rescaler':'always', 'warn_vec_size':'false'})
+
+    def test_optimal_relinearization(self):
+        """ Test that products shared by several sums are relinearized once """
+
+        prog = EvaProgram('OptimalRelinearization', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            z = Input('z')
+            w = Input('w')
+            p1 = x*y
+            p2 = z*w
+            p3 = x*w
+            Output('s', (p1 + p2) + (p2 + p3) + (p1 - p3))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'optimal_relinearize':'true', 'warn_vec_size':'false'})
+        progc, params, signature = compiler.compile(prog)
+        self.assertEqual(progc.to_DOT().count('[label="Relinearize'), 1)
+
+        self.assert_compiles_and_matches_reference(prog,
+            config={'optimal_relinearize':'true', 'warn_vec_size':'false'})
+
+    def test_rescale_divisor_search(self):
+        """ Test that searching the rescale divisor shrinks the modulus """
+
+        prog = EvaProgram('RescaleDivisorSearch', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('o', (x*y)*(x*x)*y)
+
+        prog.set_output_ranges(10)
+        prog.set_input_scales(25)
+
+        _, default_params, _ = CKKSCompiler(config={'warn_vec_size':'false'}).compile(prog)
+        progc, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'rescale_divisor':'0', 'warn_vec_size':'false'})
+        self.assertLess(sum(params.prime_bits), sum(default_params.prime_bits))
+
+        # Few 20 bit primes exist for N = 32768, so divisors that need more of
+        # them than that must not be selected
+        large = EvaProgram('RescaleDivisorSearchLarge', vec_size=16384)
+        with large:
+            x = Input('x')
+            Output('o', x*x*x*x)
+
+        large.set_output_ranges(5)
+        large.set_input_scales(20)
+
+        _, params, _ = CKKSCompiler(config={'rescale_divisor':'0',
+            'warn_vec_size':'false'}).compile(large)
+        self.assertEqual(params.poly_modulus_degree, 32768)
+        generate_keys(params)
+
+    def test_prime_selection(self):
+        """ Test that output and key primes are shrunk when it halves N """
+
+        prog = EvaProgram('PrimeSelection', vec_size=2048)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', x*y*y)
+
+        prog.set_output_ranges(10)
+        prog.set_input_scales(20)
+
+        progc, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        # The 70 bit output is split evenly instead of into 60 and 20 bits,
+        # which allows for a 35 bit key prime
+        self.assertEqual(params.prime_bits, [35, 35, 35])
+        self.assertEqual(params.poly_modulus_degree, 4096)
+
     def test_seal_no_throw_on_transparent(self):
         """ Check that SEAL is compiled with -DSEAL_THROW_ON_TRANSPARENT_CIPHERTEXT=OFF
         
@@ -151,6 +270,472 @@ class Features(EvaTestCase):
         self.assert_compiles_and_matches_reference(prog,
             config={'warn_vec_size':'false'})
     
+    def test_common_subexpressions(self):
+        """ Test that duplicate computations are merged """
+
+        prog = EvaProgram('Duplicates', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('a', (x << 1) * (x * y) + 2)
+            Output('b', (x << 1) * (y * x) + 2)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        dot = compiled.to_DOT()
+        self.assertEqual(dot.count('[label="RotateLeftConst'), 1)
+        self.assertEqual(dot.count('[label="Mul'), 2)
+
+    def test_algebraic_simplification(self):
+        """ Test that trivial multiplications, additions and negations are removed """
+
+        prog = EvaProgram('Simplify', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('a', x * 1 + y * 0)
+            Output('b', -(-x) - 0)
+            Output('c', x + -y)
+            Output('d', x * -1)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        dot = compiled.to_DOT()
+        self.assertNotIn('[label="Mul', dot)
+        self.assertNotIn('[label="Add', dot)
+        self.assertEqual(dot.count('[label="Sub'), 1)
+        self.assertEqual(dot.count('[label="Negate'), 1)
+
+    def test_power_squaring(self):
+        """ Test that repeated multiplications are rewritten into squarings """
+
+        prog = EvaProgram('Powers', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('y', x**8 * y)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        self.assertEqual(compiled.to_DOT().count('[label="Mul'), 4)
+
+    def test_rotation_factoring(self):
+        """ Test that rotations shared by the summands of a sum are factored out """
+
+        width = 8
+        prog = EvaProgram('Convolution', vec_size=64)
+        with prog:
+            image = Input('image')
+            convolved = 0
+            for i in range(3):
+                for j in range(3):
+                    weights = [i + j + k % 5 for k in range(64)]
+                    convolved += (image << (i * width + j)) * weights
+            Output('convolved', convolved)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        # Baby steps 1, 2 and giant steps 8, 16 instead of 8 rotations
+        self.assertEqual(compiled.to_DOT().count('[label="RotateLeftConst'), 4)
+        self.assertEqual(len(params.rotations), 4)
+
+    def test_rotation_folding(self):
+        """ Test that chains of rotations are folded into single rotations """
+
+        prog = EvaProgram('RotationChains', vec_size=64)
+        with prog:
+            x = Input('x')
+            Output('y', ((x << 3) << 5) + ((x >> 7) << 7))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        self.assertEqual(params.rotations, {8})
+
+    def test_rotation_canonicalization(self):
+        """ Test that equivalent rotations of a term are merged """
+
+        prog = EvaProgram('EquivalentRotations', vec_size=64)
+        with prog:
+            x = Input('x')
+            Output('y', (x << 60) * (x >> 4) + (x >> 68))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+        self.assertEqual(compiled.to_DOT().count('[label="Rotate'), 1)
+        self.assertEqual(params.rotations, {-4})
+
+    def test_rotation_key_budget(self):
+        """ Test that rotations are decomposed to stay within the key budget """
+
+        steps = [1, 3, 5, 7, 11, 13, 29, 40]
+        prog = EvaProgram('ManyRotations', vec_size=64)
+        with prog:
+            x = Input('x')
+            Output('y', sum(x << step for step in steps))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        for budget in [1, 3, 6]:
+            with self.subTest(budget=budget):
+                compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+                    config={'warn_vec_size':'false', 'max_rotation_keys':str(budget)})
+                self.assertLessEqual(len(params.rotations), budget)
+
+        # Rotations of rotations that are decomposed are decomposed too
+        chained = EvaProgram('ChainedRotations', vec_size=64)
+        with chained:
+            x = Input('x')
+            y = x
+            for step in steps:
+                y = y + (y << step)
+            Output('y', y)
+
+        chained.set_output_ranges(20)
+        chained.set_input_scales(30)
+
+        compiled, params, signature = self.assert_compiles_and_matches_reference(chained,
+            config={'warn_vec_size':'false', 'max_rotation_keys':'3'})
+        self.assertLessEqual(len(params.rotations), 3)
+
+    def test_tiling(self):
+        """ Test that vectors larger than the tile size are split into tiles """
+
+        prog = EvaProgram('Tiled', vec_size=4096)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', (x << 1000) * y + (y >> 3))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        inputs = { name: [uniform(-2,2) for _ in range(prog.vec_size)]
+            for name in prog.inputs }
+        reference = evaluate(prog, inputs)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false', 'tile_size':'1024'})
+        compiled, params, signature = compiler.compile(prog)
+        self.assertEqual(signature.vec_size, 1024)
+        self.assertEqual(signature.tiles, 4)
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+
+        mse = valuation_mse(outputs, reference)
+        self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+    def test_tiled_reductions(self):
+        """ Test reductions over whole cosets and partial reductions on tiled vectors """
+
+        # Whole cosets with strides dividing the tile size and strides larger
+        # than it, and a reduction that is rotated and masked
+        for count, stride in [(4096, 1), (2, 2048), (5, 3)]:
+            with self.subTest(count=count, stride=stride):
+                prog = EvaProgram('TiledReduction', vec_size=4096)
+                with prog:
+                    x = Input('x')
+                    c = Input('c')
+                    Output('y', horizontal_sum(x * c, count=count, stride=stride))
+
+                prog.set_output_ranges(20)
+                prog.set_input_scales(30)
+
+                # Encrypting the scalar c broadcasts it to all tiles
+                inputs = {
+                    'x': [uniform(-1,1) / 64 for _ in range(prog.vec_size)],
+                    'c': [0.5]
+                }
+                reference = evaluate(prog, dict(inputs, c=[0.5] * prog.vec_size))
+
+                compiler = CKKSCompiler(config={'warn_vec_size':'false', 'tile_size':'1024'})
+                compiled, params, signature = compiler.compile(prog)
+                self.assertEqual(signature.tiles, 4)
+
+                public_ctx, secret_ctx = generate_keys(params)
+                encInputs = public_ctx.encrypt(inputs, signature)
+                encOutputs = public_ctx.execute(compiled, encInputs)
+                outputs = secret_ctx.decrypt(encOutputs, signature)
+
+                mse = valuation_mse(outputs, reference)
+                self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+    def test_instance_packing(self):
+        """ Test that independent instances are packed into the unused slots """
+
+        prog = EvaProgram('Packed', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', (x << 3) * y + (y >> 5))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false', 'pack_instances':'true'})
+        compiled, params, signature = compiler.compile(prog)
+        instances = signature.instances
+        self.assertEqual(instances, params.poly_modulus_degree // 2 // prog.vec_size)
+
+        instance_inputs = [{ name: [uniform(-2,2) for _ in range(prog.vec_size)]
+            for name in prog.inputs } for _ in range(instances)]
+        inputs = { name: sum((inst[name] for inst in instance_inputs), [])
+            for name in prog.inputs }
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+
+        for i, inst in enumerate(instance_inputs):
+            reference = evaluate(prog, inst)
+            begin = i * prog.vec_size
+            output = { name: values[begin:begin + prog.vec_size]
+                for name, values in outputs.items() }
+            mse = valuation_mse(output, reference)
+            self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+    def test_instance_packing_horizontal_sum(self):
+        """ Test that reductions are done within each packed instance """
+
+        prog = EvaProgram('PackedSum', vec_size=64)
+        weights = [uniform(-1,1) for _ in range(prog.vec_size)]
+        with prog:
+            x = Input('x')
+            Output('s', horizontal_sum(x))
+            Output('t', horizontal_sum(x, count=8, stride=8))
+            # The reduction of a rotated constant is folded at compile time
+            Output('u', x + horizontal_sum(py_to_eva(weights) << 1))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false', 'pack_instances':'true'})
+        compiled, params, signature = compiler.compile(prog)
+        instances = signature.instances
+        self.assertGreater(instances, 1)
+
+        instance_inputs = [{ 'x': [uniform(-1,1) / 8 for _ in range(prog.vec_size)] }
+            for _ in range(instances)]
+        inputs = { 'x': sum((inst['x'] for inst in instance_inputs), []) }
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+
+        for i, inst in enumerate(instance_inputs):
+            reference = evaluate(prog, inst)
+            begin = i * prog.vec_size
+            output = { name: values[begin:begin + prog.vec_size]
+                for name, values in outputs.items() }
+            mse = valuation_mse(output, reference)
+            self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+    def test_complex_packing(self):
+        """ Test that linear programs process a second instance in the imaginary parts """
+
+        prog = EvaProgram('Linear', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', (x << 3) * 0.5 + y - (y >> 7))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false', 'complex_packing':'true'})
+        compiled, params, signature = compiler.compile(prog)
+        self.assertTrue(signature.complex_packed)
+
+        instance_inputs = [{ name: [uniform(-2,2) for _ in range(prog.vec_size)]
+            for name in prog.inputs } for _ in range(2)]
+        inputs = { name: instance_inputs[0][name] + instance_inputs[1][name]
+            for name in prog.inputs }
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+
+        for i, inst in enumerate(instance_inputs):
+            reference = evaluate(prog, inst)
+            begin = i * prog.vec_size
+            output = { name: values[begin:begin + prog.vec_size]
+                for name, values in outputs.items() }
+            mse = valuation_mse(output, reference)
+            self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+        # Scalar inputs are given to the instances in the imaginary parts too
+        scalar = EvaProgram('LinearScalar', vec_size=1)
+        with scalar:
+            x = Input('x')
+            y = Input('y')
+            Output('z', x * 0.5 + y)
+
+        scalar.set_output_ranges(20)
+        scalar.set_input_scales(30)
+
+        compiled, params, signature = compiler.compile(scalar)
+        self.assertTrue(signature.complex_packed)
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt({'x': [1.0, -1.5], 'y': [0.75]}, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+        for value, expected in zip(outputs['z'], [1.25, 0.0]):
+            self.assertAlmostEqual(value, expected, places=3)
+
+        # Adding a constant makes the program affine, which is not packed
+        affine = EvaProgram('Affine', vec_size=64)
+        with affine:
+            x = Input('x')
+            Output('z', x + 1)
+
+        affine.set_output_ranges(20)
+        affine.set_input_scales(30)
+
+        compiled, params, signature = compiler.compile(affine)
+        self.assertFalse(signature.complex_packed)
+
+    def test_autotune(self):
+        """ Test that autotune returns the cheapest of all compilations """
+
+        prog = EvaProgram('Autotune', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', (x * y + x * x * y) * (y << 1))
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false'})
+        compiled, params, signature, report = compiler.autotune(prog)
+        self.assertEqual(len(report), 24)
+        self.assertTrue(all(result.error == '' for result in report))
+        costs = [result.cost for result in report]
+        self.assertEqual(costs, sorted(costs))
+
+        inputs = { name: [uniform(-2,2) for _ in range(prog.vec_size)]
+            for name in prog.inputs }
+        reference = evaluate(prog, inputs)
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        outputs = secret_ctx.decrypt(encOutputs, signature)
+        mse = valuation_mse(outputs, reference)
+        self.assertTrue(mse < 0.01, f"Mean squared error was {mse}")
+
+        compiled, params, signature, report = compiler.autotune(prog,
+            measure=measure_execution)
+        self.assertTrue(all(result.measured for result in report))
+
+    def test_noise_simulation(self):
+        """ Test that simulated errors grow with smaller scales and predict encrypted errors """
+
+        prog = EvaProgram('NoiseSimulation', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', x * y * (y << 1) + 1)
+
+        prog.set_output_ranges(10)
+        inputs = { name: [uniform(-2,2) for _ in range(prog.vec_size)]
+            for name in prog.inputs }
+        reference = evaluate(prog, inputs)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false'})
+        previous_mse = None
+        for scale in [40, 30, 20]:
+            prog.set_input_scales(scale)
+            compiled, params, signature = compiler.compile(prog)
+            sim_mse = valuation_mse(simulate(compiled, params, inputs), reference)
+            self.assertTrue(0 < sim_mse < 0.01, f"Simulated mean squared error was {sim_mse}")
+            if previous_mse is not None:
+                self.assertGreater(sim_mse, previous_mse)
+            previous_mse = sim_mse
+
+        public_ctx, secret_ctx = generate_keys(params)
+        encInputs = public_ctx.encrypt(inputs, signature)
+        encOutputs = public_ctx.execute(compiled, encInputs)
+        he_mse = valuation_mse(secret_ctx.decrypt(encOutputs, signature), reference)
+        self.assertLess(abs(math.log10(sim_mse) - math.log10(he_mse)), 3)
+
+    def test_input_bounds(self):
+        """ Test that ranges and scales inferred from input bounds are sufficient and smaller than guesses """
+
+        prog = EvaProgram('InputBounds', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            Output('z', x*x*y + 0.5*y)
+
+        inputs = { 'x': [uniform(-3,2) for _ in range(prog.vec_size)],
+            'y': [uniform(0.5,1) for _ in range(prog.vec_size)] }
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+        _, guessed_params, _ = self.assert_compiles_and_matches_reference(prog, inputs)
+
+        prog.set_input_bounds({'x': (-3, 2), 'y': (0.5, 1)}, 20)
+        _, params, _ = self.assert_compiles_and_matches_reference(prog, inputs)
+        self.assertLess(sum(params.prime_bits), sum(guessed_params.prime_bits))
+
+        with self.assertRaises(RuntimeError):
+            prog.set_input_bounds({'x': (-3, 2)}, 20)
+
+    def test_unused_inputs(self):
+        """ Test that unused terms are not compiled and unused inputs reported """
+
+        prog = EvaProgram('DeadCode', vec_size=64)
+        with prog:
+            x = Input('x')
+            y = Input('y')
+            z = (x << 3) * y
+            Output('a', x + 1)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        compiler = CKKSCompiler(config={'warn_vec_size':'false'})
+        compiled, params, signature = compiler.compile(prog)
+        self.assertEqual(signature.unused_inputs, {'y'})
+        self.assertEqual(len(params.rotations), 0)
+        dot = compiled.to_DOT()
+        self.assertNotIn('[label="Mul', dot)
+        self.assertNotIn('[label="RotateLeftConst', dot)
+
+        # The unused input does not need to be provided for execution
+        inputs = {
+            'x': [i for i in range(prog.vec_size)]
+        }
+        public_ctx, secret_ctx = generate_keys(params)
+        enc_outputs = public_ctx.execute(compiled, public_ctx.encrypt(inputs, signature))
+        outputs = secret_ctx.decrypt(enc_outputs, signature)
+        reference = evaluate(compiled, inputs)
+        self.assertTrue(valuation_mse(outputs, reference) < 0.0000000001)
+
     def test_serialization(self):
         """ Test (de)serialization and check that results stay the same """
 
@@ -216,5 +801,111 @@ class Features(EvaTestCase):
         self.assertTrue(valuation_mse(reference, reference_compiled) < 0.0000000001)
         self.assertTrue(valuation_mse(outputs, reference) < 0.01)
 
+    def test_serialization_constant_pool(self):
+        """ Test that repeated constants are saved only once and that results stay the same """
+
+        prog = EvaProgram('Constants', vec_size=1024)
+        with prog:
+            x = Input('x')
+            weights = [i % 7 for i in range(prog.vec_size)]
+            y = x
+            for i in range(100):
+                y = y + x * weights
+            Output('y', y)
+
+        inputs = {
+            'x': [i for i in range(prog.vec_size)]
+        }
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            path = os.path.join(tmp_dir, 'constants.eva')
+            save(prog, path)
+            # Saving the weights inline would take 100 * 8 * vec_size bytes
+            self.assertLess(os.path.getsize(path), 10 * 8 * prog.vec_size)
+            loaded = load(path)
+
+        self.assertEqual(evaluate(loaded, inputs), evaluate(prog, inputs))
+
+    def test_compilation_cache(self):
+        """ Test that compilation results are cached and reused """
+
+        prog = EvaProgram('Cached', vec_size=1024)
+        with prog:
+            x = Input('x')
+            Output('y', 3*x**2 + 5*x - 2)
+
+        prog.set_output_ranges(20)
+        prog.set_input_scales(30)
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            config = {'warn_vec_size':'false', 'cache_dir':tmp_dir}
+            compiled, params, signature = CKKSCompiler(config=config).compile(prog)
+            self.assertEqual(len(os.listdir(tmp_dir)), 4)
+            cached, cached_params, cached_signature = CKKSCompiler(config=config).compile(prog)
+            self.assertEqual(len(os.listdir(tmp_dir)), 4)
+
+        self.assertEqual(cached_params.prime_bits, params.prime_bits)
+        self.assertEqual(cached_params.poly_modulus_degree, params.poly_modulus_degree)
+        inputs = {
+            'x': [i for i in range(prog.vec_size)]
+        }
+        self.assertEqual(evaluate(cached, inputs), evaluate(compiled, inputs))
+
+    def test_compilation_cache_across_processes(self):
+        """ Test that an entry stored by one process is loaded by another """
+
+        script = '''
+import sys
+from eva import EvaProgram, Input, Output
+from eva.ckks import CKKSCompiler
+prog = EvaProgram('CachedMulti', vec_size=1024)
+with prog:
+    x = Input('x')
+    y = Input('y')
+    Output('a', x * y + 1)
+    Output('b', (y << 3) - 2)
+    Output('c', x * y * [1, 2, 3, 4])
+prog.set_output_ranges(20)
+prog.set_input_scales(30)
+CKKSCompiler(config={'warn_vec_size':'false', 'cache_dir':sys.argv[1]}).compile(prog)
+'''
+        def snapshot(directory):
+            # Stored entries are renamed into place, so rewriting one changes
+            # its inode
+            return { name: os.stat(os.path.join(directory, name)).st_ino
+                for name in os.listdir(directory) }
+
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            subprocess.run([sys.executable, '-c', script, tmp_dir], check=True)
+            stored = snapshot(tmp_dir)
+            self.assertEqual(len(stored), 4)
+            subprocess.run([sys.executable, '-c', script, tmp_dir], check=True)
+            self.assertEqual(snapshot(tmp_dir), stored)
+
+    def test_compilation_cache_operand_order(self):
+        """ Test that programs differing only in operand order are cached separately """
+
+        def make_program(swap):
+            prog = EvaProgram('Difference', vec_size=1024)
+            with prog:
+                x = Input('x')
+                y = Input('y')
+                Output('z', y - x if swap else x - y)
+            prog.set_output_ranges(20)
+            prog.set_input_scales(30)
+            return prog
+
+        inputs = {
+            'x': [i for i in range(1024)],
+            'y': [2 * i for i in range(1024)]
+        }
+        with tempfile.TemporaryDirectory() as tmp_dir:
+            config = {'warn_vec_size':'false', 'cache_dir':tmp_dir}
+            for swap in [False, True]:
+                prog = make_program(swap)
+                compiled, params, signature = CKKSCompiler(config=config).compile(prog)
+                self.assertEqual(evaluate(compiled, inputs), evaluate(prog, inputs))
+            self.assertEqual(len(os.listdir(tmp_dir)), 8)
+
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file
@@ -4,7 +4,7 @@
 import unittest
 from common import *
 from eva import EvaProgram, Input, Output
-from eva.std.numeric import horizontal_sum
+from eva.std.numeric import horizontal_sum, polynomial, matvec
 
 class Std(EvaTestCase):
     def test_horizontal_sum(self):
@@ -34,5 +34,98 @@ class Std(EvaTestCase):
         self.assert_compiles_and_matches_reference(prog,
             config={'warn_vec_size':'false'})
 
+    def test_horizontal_sum_strided(self):
+        """ Test eva.std.numeric.horizontal_sum over rows and columns """
+
+        width, height = 8, 16
+        for count, stride in [(width, 1), (height, width), (5, 3)]:
+            with self.subTest(count=count, stride=stride):
+                prog = EvaProgram('HorizontalSumStrided', vec_size = width * height)
+                with prog:
+                    x = Input('x')
+                    Output('y', horizontal_sum(x, count=count, stride=stride))
+
+                prog.set_output_ranges(25)
+                prog.set_input_scales(33)
+
+                compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+                    config={'warn_vec_size':'false'})
+                # Rotate-and-add needs at most two rotations per bit of count
+                self.assertLessEqual(len(params.rotations), 2 * count.bit_length())
+
+                # Schedules are costed by the keys that are available within a
+                # budget, beyond which rotations are decomposed
+                compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+                    config={'warn_vec_size':'false', 'max_rotation_keys':'2'})
+                self.assertLessEqual(len(params.rotations), 2)
+
+    def test_polynomial(self):
+        """ Test eva.std.numeric.polynomial """
+
+        for coefficients in [[3], [1, 2], [0.5, 0, -0.25, 0.125], [1, 0.5, 0.25, 0.125, 0.0625, 0, 0, 0.01]]:
+            for enc in [True, False]:
+                prog = EvaProgram('Polynomial', vec_size = 1024)
+                with prog:
+                    x = Input('x', is_encrypted=enc)
+                    Output('y', polynomial(x, coefficients))
+
+                prog.set_output_ranges(25)
+                prog.set_input_scales(33)
+
+                self.assert_compiles_and_matches_reference(prog,
+                    config={'warn_vec_size':'false'})
+
+    def test_polynomial_composition(self):
+        """ Test eva.std.numeric.polynomial applied to another polynomial """
+
+        prog = EvaProgram('PolynomialComposition', vec_size = 1024)
+        with prog:
+            x = Input('x')
+            y = polynomial(x, [0.5, 0.25, 0, -0.125])
+            Output('z', polynomial(y, [1, -0.5, 0.25]))
+
+        prog.set_output_ranges(25)
+        prog.set_input_scales(33)
+
+        self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+
+    def test_matvec(self):
+        """ Test eva.std.numeric.matvec """
+
+        n = 64
+        dense = [[uniform(-1,1) for j in range(n)] for i in range(n)]
+        banded = [[1 if abs(i - j) <= 1 else 0 for j in range(n)] for i in range(n)]
+        rectangular = [[i + j for j in range(n // 2)] for i in range(n // 4)]
+        for matrix in [dense, banded, rectangular]:
+            prog = EvaProgram('MatVec', vec_size = n)
+            with prog:
+                x = Input('x')
+                Output('y', matvec(matrix, x))
+
+            prog.set_output_ranges(25)
+            prog.set_input_scales(33)
+
+            compiled, params, signature = self.assert_compiles_and_matches_reference(prog,
+                config={'warn_vec_size':'false'})
+            self.assertLessEqual(len(params.rotations), 16)
+
+    def test_matvec_nested(self):
+        """ Test eva.std.numeric.matvec applied to the result of another matvec """
+
+        n = 16
+        first = [[uniform(-1,1) for j in range(n)] for i in range(n)]
+        second = [[uniform(-1,1) for j in range(n)] for i in range(n)]
+        prog = EvaProgram('MatVecNested', vec_size = n)
+        with prog:
+            x = Input('x')
+            Output('y', matvec(second, matvec(first, x)))
+
+        prog.set_output_ranges(25)
+        prog.set_input_scales(33)
+
+        self.assert_compiles_and_matches_reference(prog,
+            config={'warn_vec_size':'false'})
+
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file